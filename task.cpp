@@ -18,12 +18,32 @@
 
 
 #include "isptech/coroutine/task.hpp"
+#include <climits>
 #include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <numeric>
-
+#include <system_error>
+#if !defined _WIN32
+#include <cerrno>
+#include <dirent.h>
+#include <fstream>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#if defined _MSC_VER
 #pragma warning(disable: 4073)
 #pragma init_seg(lib)
+#pragma comment(lib, "Synchronization.lib")
+#endif
 
 
 /*
@@ -37,16 +57,20 @@ namespace Coroutine {
     Names/Types
 */
 using std::accumulate;
+using std::atomic_thread_fence;
 using std::count_if;
+using std::find;
 using std::find_if;
 using std::iota;
 using std::move;
-using std::next;
 using std::literals::chrono_literals::operator""ns;
+using std::memory_order_acq_rel;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+using std::memory_order_seq_cst;
 using std::sort;
-using std::try_to_lock;
 using std::unique;
-using std::upper_bound;
 
 
 /*
@@ -74,16 +98,23 @@ Task::Operation_selector::Operation_view::channel() const
 
 
 inline bool
-Task::Operation_selector::Operation_view::dequeue(Task::Promise* taskp) const
+Task::Operation_selector::Operation_view::dequeue(Channel_waiter* waiterp) const
 {
-    return opp->dequeue(taskp, index);
+    return opp->dequeue(waiterp);
 }
 
 
 inline void
-Task::Operation_selector::Operation_view::enqueue(Task::Promise* taskp) const
+Task::Operation_selector::Operation_view::dequeue_locked(Channel_waiter* waiterp) const
+{
+    opp->dequeue_locked(waiterp);
+}
+
+
+inline bool
+Task::Operation_selector::Operation_view::enqueue(Task::Promise* taskp, Channel_waiter* waiterp) const
 {
-    opp->enqueue(taskp, index);
+    return opp->enqueue(taskp, index, waiterp);
 }
 
 
@@ -128,15 +159,28 @@ Task::Operation_selector::Operation_view::operator< (Operation_view other) const
 Task::Operation_selector::Select_guard::Select_guard(const Channel_operation* first, const Channel_operation* last, Operation_vector* outp)
     : pops(outp)
 {
-    transform(first, last, pops);
+    transform(first, last, outp);
     lock_channels(*pops);
 }
 
 
+Task::Operation_selector::Select_guard::Select_guard(const Channel_vector& chans)
+    : pchans(&chans)
+{
+    for (Channel_base* chanp : chans)
+        lock(chanp);
+}
+
+
 inline
 Task::Operation_selector::Select_guard::~Select_guard()
 {
-    unlock_channels(*pops);
+    if (pchans) {
+        for (Channel_base* chanp : *pchans)
+            unlock(chanp);
+    } else {
+        unlock_channels(*pops);
+    }
 }
 
 
@@ -170,45 +214,6 @@ Task::Operation_selector::Select_guard::lock_channels(const Operation_vector& op
 }
 
 
-void
-Task::Operation_selector::Select_guard::remove_duplicates(Operation_vector* vp)
-{
-    const auto dup = unique(vp->begin(), vp->end());
-    vp->erase(dup, vp->end());
-}
-
-
-void
-Task::Operation_selector::Select_guard::transform(const Channel_operation* first, const Channel_operation* last, Operation_vector* outp)
-{
-    /*
-        TODO: Could writing loops to skip duplicate operations (rather than
-        adding a step to remove them) result in significantly better
-        performance due to improved algorithmic efficiency?
-    */
-    transform_valid(first, last, outp);
-    sort(outp->begin(), outp->end());
-    remove_duplicates(outp);
-}
-
-
-void
-Task::Operation_selector::Select_guard::transform_valid(const Channel_operation* first, const Channel_operation* last, Operation_vector* outp)
-{
-    Operation_vector& out = *outp;
-
-    out.clear();
-    out.reserve(last - first);
-
-    for (const Channel_operation* op = first; op != last; ++op) {
-        if (op->is_valid()) {
-            const auto pos = op - first;
-            out.push_back({op, pos});
-        }
-    }
-}
-
-
 inline void
 Task::Operation_selector::Select_guard::unlock(Channel_base* chanp)
 {
@@ -227,21 +232,13 @@ Task::Operation_selector::Select_guard::unlock_channels(const Operation_vector&
     Task Operation Selector
 */
 Channel_size
-Task::Operation_selector::count_ready(const Operation_vector& ops)
-{
-    return count_if(ops.begin(), ops.end(), [](const auto op) {
-        return op.is_ready();
-    });
-}
-
-
-Channel_size
-Task::Operation_selector::dequeue(Task::Promise* taskp, const Operation_vector& ops, Channel_size selected)
+Task::Operation_selector::dequeue(const Operation_vector& ops, Channel_size selected)
 {
-    Channel_size n = 0;
+    const Channel_size  nops    = ops.size();
+    Channel_size        n       = 0;
 
-    for (const auto op : ops) {
-        if (op.position() != selected && op.dequeue(taskp))
+    for (Channel_size i = 0; i < nops; ++i) {
+        if (ops[i].position() != selected && ops[i].dequeue(&waiters[i]))
             ++n;
     }
 
@@ -249,54 +246,76 @@ Task::Operation_selector::dequeue(Task::Promise* taskp, const Operation_vector&
 }
 
 
+/*
+    The task's waiters are reused from one selection to the next (none of
+    them is queued between selections).  A lock-free channel can become
+    ready before it sees a waiter, in which case the waiters are withdrawn
+    and the ready operations are selected instead.
+*/
 Channel_size
-Task::Operation_selector::enqueue(Task::Promise* taskp, const Operation_vector& ops)
+Task::Operation_selector::enqueue(Task::Promise* taskp, const Operation_vector& ops, Operation_vector* readyp)
 {
-    for (const auto op : ops)
-        op.enqueue(taskp);
+    const Channel_size nops = ops.size();
 
-    return ops.size();
-}
+    if (waiters.size() < ops.size())
+        waiters.resize(ops.size());
 
+    for (;;) {
+        bool is_ready = false;
 
-Channel_size
-Task::Operation_selector::get_ready(const Operation_vector& ops, Channel_size n)
-{
-    assert(n > 0);
+        for (Channel_size i = 0; i < nops; ++i) {
+            if (ops[i].enqueue(taskp, &waiters[i]))
+                is_ready = true;
+        }
 
-    Channel_size ready = n;
+        if (!is_ready)
+            return nops;
 
-    for (Channel_size i = 0, remaining = n; ready == n; ++i) {
-        if (ops[i].is_ready() && --remaining == 0)
-            ready = i;
-    }
+        for (Channel_size i = 0; i < nops; ++i)
+            ops[i].dequeue_locked(&waiters[i]);
 
-    return ready;
+        if ((winner = select_ready(ops, readyp)))
+            return 0;
+    }
 }
 
 
 Task::Select_status
-Task::Operation_selector::notify_complete(Task::Promise* taskp, Channel_size pos)
+Task::Operation_selector::notify_complete(Channel_size pos)
 {
     --nenqueued;
     if (!winner) {
         winner = pos;
-        nenqueued -= dequeue(taskp, operations, pos);
+        nenqueued -= dequeue(*opsp, pos);
     }
 
     return Select_status(*winner, nenqueued == 0);
 }
 
 
-Task::Operation_selector::Operation_view
-Task::Operation_selector::pick_ready(const Operation_vector& ops, Channel_size nready)
+inline void
+Task::Operation_selector::order_pair(Operation_view* xp, Operation_view* yp)
+{
+    if (*yp < *xp)
+        std::swap(*xp, *yp);
+}
+
+
+inline Task::Operation_selector::Operation_view
+Task::Operation_selector::pick_ready(const Operation_vector& ready)
 {
-    assert(ops.size() > 0 && nready > 0);
+    const Channel_size n = ready.size();
+
+    assert(n > 0);
+    return n == 1 ? ready[0] : ready[random(0, n - 1)];
+}
 
-    const auto choice   = random(1, nready);
-    const auto i        = get_ready(ops, choice);
 
-    return ops[i];
+void
+Task::Operation_selector::remove_duplicates(Operation_vector* vp)
+{
+    const auto dup = unique(vp->begin(), vp->end());
+    vp->erase(dup, vp->end());
 }
 
 
@@ -305,19 +324,44 @@ Task::Operation_selector::select(Task::Promise* taskp, const Channel_operation*
 {
     const Select_guard guard{first, last, &operations};
 
-    winner = select_ready(operations);
-    nenqueued = winner ? 0 : enqueue(taskp, operations);
+    opsp = &operations;
+    winner = select_ready(operations, &readyops);
+    nenqueued = winner ? 0 : enqueue(taskp, operations, &readyops);
+    return !nenqueued;
+}
+
+
+bool
+Task::Operation_selector::select(Task::Promise* taskp, const Select_set& set)
+{
+    const Select_guard guard{set.channels};
+
+    opsp = &set.prepared;
+    winner = select_ready(set.prepared, &set.readyops);
+    nenqueued = winner ? 0 : enqueue(taskp, set.prepared, &set.readyops);
     return !nenqueued;
 }
 
 
+/*
+    The ready operations are gathered in a single pass, and one of them is
+    chosen at random (without drawing a random number if only one is
+    ready).
+*/
 optional<Channel_size>
-Task::Operation_selector::select_ready(const Operation_vector& ops)
+Task::Operation_selector::select_ready(const Operation_vector& ops, Operation_vector* readyp)
 {
-    optional<Channel_size> ready;
+    Operation_vector&       readyops = *readyp;
+    optional<Channel_size>  ready;
+
+    readyops.clear();
+    for (const auto op : ops) {
+        if (op.is_ready())
+            readyops.push_back(op);
+    }
 
-    if (const auto n = count_ready(ops)) {
-        const auto op = pick_ready(ops, n);
+    if (!readyops.empty()) {
+        const auto op = pick_ready(readyops);
 
         op.execute();
         ready = op.position();
@@ -334,34 +378,126 @@ Task::Operation_selector::selected() const
 }
 
 
+/*
+    Most selections are among a few alternatives, which sorting networks
+    order without the overhead of a general sort.
+*/
+void
+Task::Operation_selector::sort_operations(Operation_vector* vp)
+{
+    Operation_vector& v = *vp;
+
+    switch (v.size()) {
+    case 0:
+    case 1:
+        break;
+
+    case 2:
+        order_pair(&v[0], &v[1]);
+        break;
+
+    case 3:
+        order_pair(&v[1], &v[2]);
+        order_pair(&v[0], &v[2]);
+        order_pair(&v[0], &v[1]);
+        break;
+
+    case 4:
+        order_pair(&v[0], &v[1]);
+        order_pair(&v[2], &v[3]);
+        order_pair(&v[0], &v[2]);
+        order_pair(&v[1], &v[3]);
+        order_pair(&v[1], &v[2]);
+        break;
+
+    default:
+        sort(v.begin(), v.end());
+        break;
+    }
+}
+
+
+void
+Task::Operation_selector::transform(const Channel_operation* first, const Channel_operation* last, Operation_vector* outp)
+{
+    /*
+        TODO: Could writing loops to skip duplicate operations (rather than
+        adding a step to remove them) result in significantly better
+        performance due to improved algorithmic efficiency?
+    */
+    transform_valid(first, last, outp);
+    sort_operations(outp);
+    remove_duplicates(outp);
+}
+
+
+void
+Task::Operation_selector::transform(const Operation_vector& ops, Channel_vector* outp)
+{
+    Channel_vector& out = *outp;
+
+    out.clear();
+    for (const auto op : ops) {
+        Channel_base* chanp = op.channel();
+        if (chanp && (out.empty() || chanp != out.back()))
+            out.push_back(chanp);
+    }
+}
+
+
+void
+Task::Operation_selector::transform_valid(const Channel_operation* first, const Channel_operation* last, Operation_vector* outp)
+{
+    Operation_vector& out = *outp;
+
+    out.clear();
+    out.reserve(last - first);
+
+    for (const Channel_operation* op = first; op != last; ++op) {
+        if (op->is_valid()) {
+            const auto pos = op - first;
+            out.push_back({op, pos});
+        }
+    }
+}
+
+
 optional<Channel_size>
 Task::Operation_selector::try_select(const Channel_operation* first, const Channel_operation* last)
 {
     const Select_guard guard{first, last, &operations};
-    return select_ready(operations);
+    return select_ready(operations, &readyops);
+}
+
+
+optional<Channel_size>
+Task::Operation_selector::try_select(const Select_set& set)
+{
+    const Select_guard guard{set.channels};
+    return select_ready(set.prepared, &set.readyops);
 }
 
 
 /*
-    Task Future Selector Channel Locks
+    Task Future Selector State Locks
 */
 void
-Task::Future_selector::Channel_locks::acquire(const Future_wait_index& index, const Future_waits& fwaits, const Channel_waits& cwaits)
+Task::Future_selector::State_locks::acquire(const Future_wait_index& index, const Future_waits& fwaits, const State_waits& swaits)
 {
-    transform(index, fwaits, cwaits, &chans);
-    sort(&chans);
-    lock(chans);
+    transform(index, fwaits, swaits, &states);
+    sort(&states);
+    lock(states);
 }
 
 
 template<class T>
 void
-Task::Future_selector::Channel_locks::for_each_unique(const Channels& cs, T func)
+Task::Future_selector::State_locks::for_each_unique(const States& ss, T func)
 {
-    Channel_base* prev = nullptr;
+    Future_state_base* prev = nullptr;
 
-    for (auto pp = cs.begin(), end = cs.end(); pp != end; ++pp) {
-        Channel_base* p = *pp;
+    for (auto pp = ss.begin(), end = ss.end(); pp != end; ++pp) {
+        Future_state_base* p = *pp;
         if (p && p != prev)
             func(p);
         prev = p;
@@ -370,65 +506,62 @@ Task::Future_selector::Channel_locks::for_each_unique(const Channels& cs, T func
 
 
 inline void
-Task::Future_selector::Channel_locks::lock(const Channels& chans)
+Task::Future_selector::State_locks::lock(const States& states)
 {
-    for_each_unique(chans, lock_channel);
+    for_each_unique(states, lock_state);
 }
 
 
 inline void
-Task::Future_selector::Channel_locks::lock_channel(Channel_base* chanp)
+Task::Future_selector::State_locks::lock_state(Future_state_base* statep)
 {
-    chanp->lock();
+    statep->lock();
 }
 
 
 inline
-Task::Future_selector::Channel_locks::operator bool() const
+Task::Future_selector::State_locks::operator bool() const
 {
-    return !chans.empty();
+    return !states.empty();
 }
 
 
 void
-Task::Future_selector::Channel_locks::release()
+Task::Future_selector::State_locks::release()
 {
-    unlock(chans);
-    chans.clear();
+    unlock(states);
+    states.clear();
 }
 
 
 inline void
-Task::Future_selector::Channel_locks::sort(Channels* chansp)
+Task::Future_selector::State_locks::sort(States* statesp)
 {
-    std::sort(chansp->begin(), chansp->end());
+    std::sort(statesp->begin(), statesp->end());
 }
 
 
 void
-Task::Future_selector::Channel_locks::transform(const Future_wait_index& index, const Future_waits& fwaits, const Channel_waits& cwaits, Channels* chansp)
+Task::Future_selector::State_locks::transform(const Future_wait_index& index, const Future_waits& fwaits, const State_waits& swaits, States* statesp)
 {
-    chansp->reserve(cwaits.size());
+    statesp->reserve(swaits.size());
 
-    for (auto i : index) {
-        const auto& fw = fwaits[i];
-        chansp->push_back(cwaits[fw.value()].channel());
-        chansp->push_back(cwaits[fw.error()].channel());
-    }
+    for (auto i : index)
+        statesp->push_back(swaits[fwaits[i].wait()].state());
 }
 
 
 inline void
-Task::Future_selector::Channel_locks::unlock(const Channels& chans)
+Task::Future_selector::State_locks::unlock(const States& states)
 {
-    for_each_unique(chans, unlock_channel);
+    for_each_unique(states, unlock_state);
 }
 
 
 inline void
-Task::Future_selector::Channel_locks::unlock_channel(Channel_base* chanp)
+Task::Future_selector::State_locks::unlock_state(Future_state_base* statep)
 {
-    chanp->unlock();
+    statep->unlock();
 }
 
 
@@ -436,69 +569,40 @@ Task::Future_selector::Channel_locks::unlock_channel(Channel_base* chanp)
     Task Future Selector Future Wait
 */
 bool
-Task::Future_selector::Future_wait::complete(Task::Promise* taskp, const Channel_waits& waits, Channel_size pos) const
-{
-    const Channel_wait& wait        = waits[pos];
-    const auto          otherpos    = (pos == vpos) ? epos : vpos;
-    const Channel_wait& other       = waits[otherpos];
-
-    *signalp = true;
-    wait.complete();
-    dequeue_unlocked(taskp, other, otherpos);
-    return !other.is_enqueued();
-}
-
-
-bool
-Task::Future_selector::Future_wait::dequeue(Task::Promise* taskp, const Channel_waits& waits) const
+Task::Future_selector::Future_wait::dequeue(Task::Promise* taskp, const State_waits& waits) const
 {
-    const auto& v           = waits[vpos];
-    const auto& e           = waits[epos];
-    const bool was_enqueued = is_enqueued(v, e);
-
-    v.dequeue(taskp, vpos);
-    e.dequeue(taskp, epos);
+    const auto& w           = waits[pos];
+    const bool was_enqueued = w.is_enqueued();
 
-    return was_enqueued && !is_enqueued(v, e);
-}
-
-
-inline void
-Task::Future_selector::Future_wait::dequeue_unlocked(Task::Promise* taskp, const Channel_wait& wait, Channel_size pos)
-{
-    const Channel_lock lock{wait.channel()};
-    wait.dequeue(taskp, pos);
+    w.dequeue(taskp, pos);
+    return was_enqueued && !w.is_enqueued();
 }
 
 
 bool
-Task::Future_selector::Future_wait::dequeue_unlocked(Task::Promise* taskp, const Channel_waits& waits) const
+Task::Future_selector::Future_wait::dequeue_unlocked(Task::Promise* taskp, const State_waits& waits) const
 {
-    const auto& vwait       = waits[vpos];
-    const auto& ewait       = waits[epos];
-    const bool was_enqueued = is_enqueued(vwait, ewait);
-
-    dequeue_unlocked(taskp, vwait, vpos);
-    dequeue_unlocked(taskp, ewait, epos);
-    return was_enqueued && !is_enqueued(vwait, ewait);
-}
+    const auto& w           = waits[pos];
+    const bool was_enqueued = w.is_enqueued();
 
+    if (was_enqueued) {
+        w.state()->lock();
+        w.dequeue(taskp, pos);
+        w.state()->unlock();
+    }
 
-inline bool
-Task::Future_selector::Future_wait::is_enqueued(const Channel_wait& x, const Channel_wait& y)
-{
-    return x.is_enqueued() || y.is_enqueued();
+    return was_enqueued && !w.is_enqueued();
 }
 
 
 /*
-    Task Future Selector Dequeue From Locked Channel
+    Task Future Selector Dequeue From Locked State
 */
 inline
-Task::Future_selector::dequeue_from_locked::dequeue_from_locked(Task::Promise* tskp, const Future_waits& fws, const Channel_waits& cws)
+Task::Future_selector::dequeue_from_locked::dequeue_from_locked(Task::Promise* tskp, const Future_waits& fws, const State_waits& sws)
     : taskp{tskp}
     , fwaits{fws}
-    , cwaits{cws}
+    , swaits{sws}
 {
 }
 
@@ -506,7 +610,7 @@ Task::Future_selector::dequeue_from_locked::dequeue_from_locked(Task::Promise* t
 Channel_size
 Task::Future_selector::dequeue_from_locked::operator()(Channel_size n, Channel_size i) const
 {
-    if (fwaits[i].dequeue(taskp, cwaits))
+    if (fwaits[i].dequeue(taskp, swaits))
         ++n;
 
     return n;
@@ -514,13 +618,13 @@ Task::Future_selector::dequeue_from_locked::operator()(Channel_size n, Channel_s
 
 
 /*
-    Task Future Selector Dequeue From Unlocked Channel
+    Task Future Selector Dequeue From Unlocked State
 */
 inline
-Task::Future_selector::dequeue_from_unlocked::dequeue_from_unlocked(Task::Promise* tskp, const Future_waits& fws, const Channel_waits& cws)
+Task::Future_selector::dequeue_from_unlocked::dequeue_from_unlocked(Task::Promise* tskp, const Future_waits& fws, const State_waits& sws)
     : taskp{tskp}
     , fwaits{fws}
-    , cwaits{cws}
+    , swaits{sws}
 {
 }
 
@@ -528,7 +632,7 @@ Task::Future_selector::dequeue_from_unlocked::dequeue_from_unlocked(Task::Promis
 Channel_size
 Task::Future_selector::dequeue_from_unlocked::operator()(Channel_size n, Channel_size i) const
 {
-    if (fwaits[i].dequeue_unlocked(taskp, cwaits))
+    if (fwaits[i].dequeue_unlocked(taskp, swaits))
         ++n;
 
     return n;
@@ -539,10 +643,10 @@ Task::Future_selector::dequeue_from_unlocked::operator()(Channel_size n, Channel
     Task Future Selector Enqueue Not Ready
 */
 inline
-Task::Future_selector::enqueue_not_ready::enqueue_not_ready(Task::Promise* tskp, const Future_waits& fws, const Channel_waits& cws)
+Task::Future_selector::enqueue_not_ready::enqueue_not_ready(Task::Promise* tskp, const Future_waits& fws, const State_waits& sws)
     : taskp{tskp}
     , fwaits{fws}
-    , cwaits{cws}
+    , swaits{sws}
 {
 }
 
@@ -552,8 +656,8 @@ Task::Future_selector::enqueue_not_ready::operator()(Channel_size n, Channel_siz
 {
     const auto& fwait = fwaits[i];
 
-    if (!fwait.is_ready(cwaits)) {
-        fwait.enqueue(taskp, cwaits);
+    if (!fwait.is_ready(swaits)) {
+        fwait.enqueue(taskp, swaits);
         ++n;
     }
 
@@ -565,10 +669,10 @@ Task::Future_selector::enqueue_not_ready::operator()(Channel_size n, Channel_siz
     Task Future Selector Wait Set
 */
 Channel_size
-Task::Future_selector::Wait_set::count_ready(const Future_wait_index& index, const Future_waits& fwaits, const Channel_waits& cwaits)
+Task::Future_selector::Wait_set::count_ready(const Future_wait_index& index, const Future_waits& fwaits, const State_waits& swaits)
 {
     return count_if(index.begin(), index.end(), [&](auto i) {
-        return fwaits[i].is_ready(cwaits);
+        return fwaits[i].is_ready(swaits);
     });
 }
 
@@ -580,9 +684,9 @@ Task::Future_selector::Wait_set::dequeue(Task::Promise* taskp)
 
     if (nenqueued > 0) {
         if (locks)
-            n = dequeue_locked(taskp, index, futures, channels);
+            n = dequeue_locked(taskp, index, futures, states);
         else
-            n = dequeue_unlocked(taskp, index, futures, channels);
+            n = dequeue_unlocked(taskp, index, futures, states);
 
         nenqueued -= n;
     }
@@ -592,16 +696,16 @@ Task::Future_selector::Wait_set::dequeue(Task::Promise* taskp)
 
 
 inline Channel_size
-Task::Future_selector::Wait_set::dequeue_locked(Task::Promise* taskp, const Future_wait_index& index, const Future_waits& fwaits, const Channel_waits& cwaits)
+Task::Future_selector::Wait_set::dequeue_locked(Task::Promise* taskp, const Future_wait_index& index, const Future_waits& fwaits, const State_waits& swaits)
 {
-    return accumulate(index.begin(), index.end(), 0, dequeue_from_locked(taskp, fwaits, cwaits));
+    return accumulate(index.begin(), index.end(), 0, dequeue_from_locked(taskp, fwaits, swaits));
 }
 
 
 inline Channel_size
-Task::Future_selector::Wait_set::dequeue_unlocked(Task::Promise* taskp, const Future_wait_index& index, const Future_waits& fwaits, const Channel_waits& cwaits)
+Task::Future_selector::Wait_set::dequeue_unlocked(Task::Promise* taskp, const Future_wait_index& index, const Future_waits& fwaits, const State_waits& swaits)
 {
-    return accumulate(index.begin(), index.end(), 0, dequeue_from_unlocked(taskp, fwaits, cwaits));
+    return accumulate(index.begin(), index.end(), 0, dequeue_from_unlocked(taskp, fwaits, swaits));
 }
 
 
@@ -611,21 +715,21 @@ Task::Future_selector::Wait_set::enqueue(Task::Promise* taskp)
 {
     Channel_size n = 0;
 
-    n = accumulate(index.begin(), index.end(), n, enqueue_not_ready(taskp, futures, channels));
+    n = accumulate(index.begin(), index.end(), n, enqueue_not_ready(taskp, futures, states));
     nenqueued += n;
     return n;
 }
 
 
 Channel_size
-Task::Future_selector::Wait_set::get_ready(const Future_wait_index& index, const Future_waits& fwaits, const Channel_waits& cwaits, Channel_size n)
+Task::Future_selector::Wait_set::get_ready(const Future_wait_index& index, const Future_waits& fwaits, const State_waits& swaits, Channel_size n)
 {
     assert(n > 0);
 
     Channel_size pos = -1;
 
     for (Channel_size i = 0, count = 0; count < n; ++i) {
-        if (fwaits[index[i]].is_ready(cwaits) && ++count == n)
+        if (fwaits[index[i]].is_ready(swaits) && ++count == n)
             pos = i;
     }
 
@@ -653,19 +757,19 @@ Task::Future_selector::Wait_set::init(Future_wait_index* indexp, const Future_wa
 
 
 void
-Task::Future_selector::Wait_set::lock_channels()
+Task::Future_selector::Wait_set::lock_states()
 {
-    locks.acquire(index, futures, channels);
+    locks.acquire(index, futures, states);
 }
 
 
 Channel_size
-Task::Future_selector::Wait_set::notify_readable(Task::Promise* taskp, Channel_size chan)
+Task::Future_selector::Wait_set::notify_readable(Task::Promise* /*taskp*/, Channel_size wait)
 {
-    const Channel_size i = channels[chan].future();
+    const Channel_size i = states[wait].future();
     const Future_wait& f = futures[i];
 
-    if (f.complete(taskp, channels, chan))
+    if (f.complete(states))
         --nenqueued;
 
     return i;
@@ -673,13 +777,13 @@ Task::Future_selector::Wait_set::notify_readable(Task::Promise* taskp, Channel_s
 
 
 optional<Channel_size>
-Task::Future_selector::Wait_set::pick_ready(const Future_wait_index& index, const Future_waits& fwaits, const Channel_waits& cwaits, Channel_size nready)
+Task::Future_selector::Wait_set::pick_ready(const Future_wait_index& index, const Future_waits& fwaits, const State_waits& swaits, Channel_size nready)
 {
     optional<Channel_size> ready;
 
     if (nready > 0) {
         const Channel_size choice = random(1, nready);
-        ready = get_ready(index, fwaits, cwaits, choice);
+        ready = get_ready(index, fwaits, swaits, choice);
     }
 
     return ready;
@@ -700,8 +804,8 @@ Task::Future_selector::Wait_set::remove_duplicates(Future_wait_index* indexp, co
 optional<Channel_size>
 Task::Future_selector::Wait_set::select_ready()
 {
-    const auto n = count_ready(index, futures, channels);
-    return pick_ready(index, futures, channels, n);
+    const auto n = count_ready(index, futures, states);
+    return pick_ready(index, futures, states, n);
 }
 
 
@@ -715,7 +819,7 @@ Task::Future_selector::Wait_set::sort(Future_wait_index* indexp, const Future_wa
 
 
 void
-Task::Future_selector::Wait_set::unlock_channels()
+Task::Future_selector::Wait_set::unlock_states()
 {
     locks.release();
 }
@@ -725,10 +829,13 @@ Task::Future_selector::Wait_set::unlock_channels()
     Task Future Selector Timer
 */
 inline void
-Task::Future_selector::Timer::cancel(Task::Promise* taskp) const
+Task::Future_selector::Timer::cancel() const
 {
-    scheduler.cancel_timer(taskp);
-    state = cancel_pending;
+    /*
+        If the alarm has already been taken from the queue, its expiry
+        notification is on the way and will complete the cancellation.
+    */
+    state = schedp->cancel_timer(alarm) ? inactive : cancel_pending;
 }
 
 
@@ -786,7 +893,7 @@ Task::Future_selector::notify_channel_readable(Task::Promise* taskp, Channel_siz
         ready = pos;
         waits.dequeue(taskp);
         if (timer.is_running())
-            timer.cancel(taskp);
+            timer.cancel();
     }
 
     return is_ready(waits, timer);
@@ -812,87 +919,94 @@ Task::Future_selector::notify_timer_expired(Task::Promise* taskp, Time when)
 }
 
 
-bool
-Task::Future_selector::notify_timer_canceled()
-{
-    timer.notify_canceled();
-    return !waits.enqueued();
-}
-
-
 /*
-    Task Local Implementation Map Key Equality Predicate
+    Task Local Slots
 */
-inline
-Task::Local_impl_map::key_eq::key_eq(Local_key k)
-    : key{k}
+void*
+Task::Local_slots::release(Local_key key)
 {
+    const std::size_t   i       = key.index;
+    void*               objectp = nullptr;
+
+    if (i < ninline)
+        objectp = inlines[i].release(key.generation);
+    else if (i - ninline < overflow.size())
+        objectp = overflow[i - ninline].release(key.generation);
+
+    return objectp;
 }
 
 
-inline bool
-Task::Local_impl_map::key_eq::operator()(const Value& v) const
+void
+Task::Local_slots::reset(Local_key key, void* objectp, const Local_deleter_ptr& deleterp)
 {
-    return v.first == key;
+    std::size_t i = key.index;
+
+    if (i < ninline)
+        inlines[i].reset(key.generation, objectp, deleterp);
+    else {
+        i -= ninline;
+        if (i >= overflow.size()) {
+            if (!objectp)
+                return;
+            overflow.resize(i + 1);
+        }
+        overflow[i].reset(key.generation, objectp, deleterp);
+    }
 }
 
 
 /*
-    Task Local Implementation Map
+    Task Promise
 */
-void
-Task::Local_impl_map::erase(Local_key key)
+Task::Promise::Promise()
+    : taskstate{State::ready}
+    , runtime{0}
+    , taskprio{Task_priority::normal}
+    , schedp{nullptr}
 {
-    const auto first    = values.begin();
-    const auto last     = values.end();
-    const auto p        = find_if(first, last, key_eq(key));
-
-    if (p != last)
-        values.erase(p);
 }
 
 
-void*
-Task::Local_impl_map::find(Local_key key)
+inline void
+Task::Promise::add_run_time(Duration dt)
 {
-    const auto first    = values.begin();
-    const auto last     = values.end();
-    const auto p        = find_if(first, last, key_eq(key));
+    runtime += dt;
+}
+
 
-    return (p != last) ? p->second.get() : nullptr;
+inline void
+Task::Promise::make_ready()
+{
+    taskstate = State::ready;
 }
 
 
-void*
-Task::Local_impl_map::release(Local_key key)
+Duration
+Task::Promise::run_time() const
 {
-    void*       objectp = nullptr;
-    const auto  first   = values.begin();
-    const auto  last    = values.end();
-    const auto  p       = find_if(first, last, key_eq(key));
+    return runtime;
+}
 
-    if (p != last) {
-        objectp = p->second.release();
-        values.erase(p);
-    }
 
-    return objectp;
+inline void
+Task::Promise::owner(Scheduler* sp)
+{
+    schedp = sp;
 }
 
 
-/*
-    Task Promise
-*/
-Task::Promise::Promise()
-    : taskstate{State::ready}
+inline Task_priority
+Task::Promise::priority() const
 {
+    return taskprio;
 }
 
 
 inline void
-Task::Promise::make_ready()
+Task::Promise::priority(Task_priority prio)
 {
-    taskstate = State::ready;
+    taskprio = prio;
 }
 
 
@@ -911,71 +1025,228 @@ Task::Promise::unlock()
 
 
 /*
-    Task
+    Task Local Keys
+
+    The index of a destroyed Task_local is given to the next one
+    constructed, so the slots of a task don't grow with every Task_local
+    ever made.  Each key has a new generation.
 */
-Channel_size
-Task::random(Channel_size min, Channel_size max)
-{
-    using Device        = std::random_device;
-    using Engine        = std::default_random_engine;
-    using Distribution  = std::uniform_int_distribution<Channel_size>;
+namespace {
 
-    static Device   rand;
-    static Engine   engine{rand()};
-    Distribution    dist{min, max};
+struct Local_key_pool {
+    std::mutex                  mutex;
+    std::vector<std::size_t>    free;
+    std::size_t                 nindices{0};
+    std::size_t                 ngenerations{0};
+};
 
-    return dist(engine);
-}
-    
-   
-/*
-    Channel Operation
-*/
-bool
-Channel_operation::dequeue(Task::Promise* taskp, Channel_size pos) const
+
+Local_key_pool&
+local_key_pool()
 {
-    bool is_dequeued;
+    static Local_key_pool pool;
+    return pool;
+}
 
-    if (chanp) {
-        Task::Channel_lock lock(chanp);
+}   // namespace
 
-        switch(type) {
-        case Type::send:
-            is_dequeued = chanp->dequeue_send(taskp, pos);
-            break;
 
-        case Type::receive:
-            is_dequeued = chanp->dequeue_receive(taskp, pos);
-            break;
-        }
-    }
+/*
+    Task
+*/
+void
+Task::free_local_key(Local_key key)
+{
+    Local_key_pool& pool = local_key_pool();
+    const Lock      lock{pool.mutex};
 
-    return is_dequeued;
+    pool.free.push_back(key.index);
 }
 
 
-void
-Channel_operation::enqueue(Task::Promise* taskp, Channel_size pos) const
+Task::Local_key
+Task::make_local_key()
 {
-    switch(type) {
-    case Type::send:
-        if (valp)
-            chanp->enqueue_send(taskp, pos, valp);
-        else
-            chanp->enqueue_send(taskp, pos, constvalp);
-        break;
+    Local_key_pool& pool = local_key_pool();
+    const Lock      lock{pool.mutex};
+    Local_key       key;
 
-    case Type::receive:
-        chanp->enqueue_receive(taskp, pos, valp);
-        break;
+    if (pool.free.empty())
+        key.index = pool.nindices++;
+    else {
+        key.index = pool.free.back();
+        pool.free.pop_back();
     }
+
+    key.generation = ++pool.ngenerations;
+    return key;
 }
 
 
-void
-Channel_operation::execute() const
+Channel_size
+Task::random(Channel_size min, Channel_size max)
 {
-    switch(type) {
+    return Scheduler::this_scheduler().random(min, max);
+}
+    
+   
+/*
+    Thread Parker
+*/
+namespace {
+
+const unsigned min_park_spins{16};
+const unsigned max_park_spins{4096};
+
+
+inline void
+pause_cpu()
+{
+#if defined _WIN32
+    YieldProcessor();
+#elif defined __i386__ || defined __x86_64__
+    __builtin_ia32_pause();
+#endif
+}
+
+
+/*
+    The number of times a thread polls a parker before sleeping.  It grows
+    while releases arrive within the spin and shrinks when they don't, so
+    that threads whose peers answer quickly avoid a system call and the
+    rest waste little time spinning.
+*/
+unsigned&
+this_thread_spins()
+{
+    thread_local unsigned nspins{min_park_spins * 4};
+    return nspins;
+}
+
+}   // namespace
+
+
+void
+Thread_parker::park()
+{
+    unsigned& nspins = this_thread_spins();
+
+    for (unsigned i = 0; i < nspins; ++i) {
+        if (state.load(memory_order_acquire) == released) {
+            nspins = std::min(nspins * 2, max_park_spins);
+            return;
+        }
+        pause_cpu();
+    }
+
+    nspins = std::max(nspins / 2, min_park_spins);
+
+    std::uint32_t expected = empty;
+    if (state.compare_exchange_strong(expected, sleeping, memory_order_acquire)) {
+        while (state.load(memory_order_acquire) != released)
+            sleep();
+    }
+}
+
+
+void
+Thread_parker::unpark()
+{
+    if (state.exchange(released, memory_order_release) == sleeping)
+        wake();
+}
+
+
+#if defined _WIN32
+
+inline void
+Thread_parker::sleep()
+{
+    std::uint32_t asleep = sleeping;
+
+    WaitOnAddress(&state, &asleep, sizeof asleep, INFINITE);
+}
+
+
+inline void
+Thread_parker::wake()
+{
+    WakeByAddressSingle(&state);
+}
+
+#else
+
+/*
+    The futex calls pass the address of the atomic's value, which is lock
+    free (and so has the representation of a std::uint32_t).  A wait is
+    retried by the caller if it's interrupted or the state has changed.
+*/
+inline void
+Thread_parker::sleep()
+{
+    syscall(SYS_futex, &state, FUTEX_WAIT_PRIVATE, sleeping, nullptr, nullptr, 0);
+}
+
+
+inline void
+Thread_parker::wake()
+{
+    syscall(SYS_futex, &state, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+#endif
+
+
+/*
+    Channel Operation
+*/
+bool
+Channel_operation::dequeue(Channel_waiter* waiterp) const
+{
+    bool is_dequeued = false;
+
+    if (chanp) {
+        Task::Channel_lock lock(chanp);
+        is_dequeued = dequeue_locked(waiterp);
+    }
+
+    return is_dequeued;
+}
+
+
+bool
+Channel_operation::dequeue_locked(Channel_waiter* waiterp) const
+{
+    switch(type) {
+    case Type::send:    return chanp->dequeue_send(waiterp);
+    case Type::receive: return chanp->dequeue_receive(waiterp);
+    default:            return false;
+    }
+}
+
+
+bool
+Channel_operation::enqueue(Task::Promise* taskp, Channel_size pos, Channel_waiter* waiterp) const
+{
+    switch(type) {
+    case Type::send:
+        waiterp->assign(taskp, pos, constvalp, valp);
+        return chanp->enqueue_send(waiterp);
+
+    case Type::receive:
+        waiterp->assign(taskp, pos, nullptr, valp);
+        return chanp->enqueue_receive(waiterp);
+
+    default:
+        return false;
+    }
+}
+
+
+void
+Channel_operation::execute() const
+{
+    switch(type) {
     case Type::send:
         if (valp)
             chanp->send(valp);
@@ -990,6 +1261,17 @@ Channel_operation::execute() const
 }
 
 
+bool
+Channel_operation::try_execute() const
+{
+    switch(type) {
+    case Type::send:    return valp ? chanp->fast_send(valp) : chanp->fast_send(constvalp);
+    case Type::receive: return chanp->fast_receive(valp);
+    default:            return false;
+    }
+}
+
+
 bool
 Channel_operation::is_ready() const
 {
@@ -1002,823 +1284,2385 @@ Channel_operation::is_ready() const
 
 
 /*
-    Future "void" Awaitable
+    Channel Operation Select Set
 */
-void
-Future<void>::Awaitable::await_resume()
+Select_set::Select_set(const Channel_operation* first, const Channel_operation* last)
 {
-    /*
-        If a future is ready, the result can be obtained from one of its
-        channels without waiting.  Otherwise, the task waiting on this
-        future has just awakened from a call to select() having received
-        either a value or an error.
-    */
-    if (selfp->is_ready())
-        selfp->get_ready();
-    else if (ep)
-        rethrow_exception(ep);
+    assign(first, last);
 }
 
 
-bool
-Future<void>::Awaitable::await_suspend(Task::Handle task)
+void
+Select_set::assign(const Channel_operation* first, const Channel_operation* last)
 {
-    ops[0] = selfp->vchan.make_receive();
-    ops[1] = selfp->echan.make_receive(&ep);
-    task.promise().select(ops);
-    return true;
+    using Selector = Task::Operation_selector;
+
+    ops.assign(first, last);
+
+    const Channel_operation* opsfirst = ops.data();
+    Selector::transform(opsfirst, opsfirst + ops.size(), &prepared);
+    Selector::transform(prepared, &channels);
+    readyops.reserve(prepared.size());
 }
 
 
 /*
-    Future of "void"
+    Future State
 */
+bool
+Future_state_base::dequeue_readable_wait(Task::Promise* taskp, Channel_size wait)
+{
+    const bool is_found = waiterp == taskp && waitpos == wait;
+
+    if (is_found)
+        waiterp = nullptr;
+
+    return is_found;
+}
+
+
 void
-Future<void>::get_ready()
+Future_state_base::enqueue_readable_wait(Task::Promise* taskp, Channel_size wait)
 {
-    if (vchan.try_receive())
-        isready = false;
-    else if (optional<exception_ptr> epp = echan.try_receive()) {
-        isready = false;
-        rethrow_exception(*epp);
-    }
+    assert(!waiterp);
+    waiterp = taskp;
+    waitpos = wait;
 }
 
 
-bool
-Future<void>::try_get()
+void
+Future_state_base::publish()
 {
-    const bool is_value = vchan.try_receive();
+    Task::Promise*  taskp;
+    Channel_size    pos;
 
-    if (is_value)
-        isready = false;
-    else if (optional<exception_ptr> epp = echan.try_receive()) {
-        isready = false;
-        rethrow_exception(*epp);
+    {
+        const Lock lock{mutex};
+
+        isready.store(true, memory_order_release);
+        taskp   = waiterp;
+        pos     = waitpos;
+        waiterp = nullptr;
     }
 
-    return is_value;
+    /*
+        Notify the waiter with the state unlocked, because an awakened task
+        could be dequeuing itself from the state.
+    */
+    if (taskp && taskp->notify_channel_readable(pos))
+        taskp->owner()->resume(taskp);
 }
 
 
-bool
-operator==(const Future<void>& x, const Future<void>& y)
+void
+Future_state<void>::get()
 {
-    if (x.vchan != y.vchan) return false;
-    if (x.echan != y.echan) return false;
-    if (x.isready != y.isready) return false;
-    return true;
+    if (error)
+        rethrow_exception(error);
 }
 
 
 void
-swap(Future<void>& x, Future<void>& y)
+Future_state<void>::set_exception(exception_ptr ep)
 {
-    using std::swap;
+    error = ep;
+    publish();
+}
 
-    swap(x.vchan, y.vchan);
-    swap(x.echan, y.echan);
-    swap(x.isready, y.isready);
+
+void
+Future_state<void>::set_value()
+{
+    publish();
 }
 
 
 /*
-    Scheduler Suspended Tasks
+    Future of "void"
 */
-inline
-Scheduler::Waiting_tasks::handle_eq::handle_eq(Task::Handle task)
-    : h{task}
+bool
+Future<void>::try_get()
 {
+    const bool is_value = is_ready();
+
+    if (is_value)
+        get_ready();
+
+    return is_value;
 }
 
 
-inline bool
-Scheduler::Waiting_tasks::handle_eq::operator()(const Task& task) const
+bool
+operator==(const Future<void>& x, const Future<void>& y)
 {
-    return task.handle() == h;
+    return x.statep == y.statep;
 }
 
 
 void
-Scheduler::Waiting_tasks::insert(Task&& task)
+swap(Future<void>& x, Future<void>& y)
 {
-    const Lock lock{mutex};
+    using std::swap;
 
-    tasks.push_back(move(task));
-    tasks.back().unlock();
+    swap(x.statep, y.statep);
 }
 
 
-Task
-Scheduler::Waiting_tasks::release(Task::Handle h)
+/*
+    Scheduler Waiting Task List
+*/
+bool
+Scheduler::Waiting_tasks::Task_list::erase(Task::Promise* taskp)
 {
-    Task        task;
-    const Lock  lock{mutex};
-    const auto  taskp = find_if(tasks.begin(), tasks.end(), handle_eq(h));
+    Task::Waiting_link& l = link(taskp);
+    const bool          is_linked = l.is_linked;
+
+    if (is_linked) {
+        if (l.prevp)
+            link(l.prevp).nextp = l.nextp;
+        else
+            headp = l.nextp;
 
-    if (taskp != tasks.end()) {
-        task = move(*taskp);
-        tasks.erase(taskp);
+        if (l.nextp)
+            link(l.nextp).prevp = l.prevp;
+
+        l = Task::Waiting_link{};
     }
 
-    return task;
+    return is_linked;
 }
 
 
-/*
-    Sheduler Task Queue
-*/
-void
-Scheduler::Task_queue::interrupt()
+inline Task::Waiting_link&
+Scheduler::Waiting_tasks::Task_list::link(Task::Promise* taskp)
 {
-    const Lock lock{mutex};
+    return taskp->waitlink;
+}
 
-    is_interrupt = true;
-    ready.notify_one();
+
+Task::Promise*
+Scheduler::Waiting_tasks::Task_list::pop()
+{
+    Task::Promise* taskp = headp;
+
+    if (taskp)
+        erase(taskp);
+
+    return taskp;
 }
 
 
-Task
-Scheduler::Task_queue::pop()
+void
+Scheduler::Waiting_tasks::Task_list::push(Task::Promise* taskp)
 {
-    Task task;
-    Lock lock{mutex};
+    Task::Waiting_link& l = link(taskp);
 
-    while (tasks.empty() && !is_interrupt)
-        ready.wait(lock);
+    assert(!l.is_linked);
+    l.prevp     = nullptr;
+    l.nextp     = headp;
+    l.is_linked = true;
 
-    if (!tasks.empty())
-        task = pop_front(&tasks);
+    if (headp)
+        link(headp).prevp = taskp;
 
-    return task;
+    headp = taskp;
 }
 
 
-inline Task
-Scheduler::Task_queue::pop_front(std::deque<Task>* tasksp)
+/*
+    Scheduler Waiting Tasks
+*/
+Scheduler::Waiting_tasks::~Waiting_tasks()
 {
-    Task task{move(tasksp->front())};
-
-    tasksp->pop_front();
-    return task;
+    // Destroy the tasks that were never resumed.
+    for (auto& s : shards) {
+        while (Task::Promise* taskp = s.tasks.pop()) {
+            const Task task{Task::Handle::from_promise(*taskp)};
+        }
+    }
 }
 
 
 void
-Scheduler::Task_queue::push(Task&& task)
+Scheduler::Waiting_tasks::insert(Task&& task)
 {
-    const Lock lock{mutex};
+    Task::Promise* taskp = &task.handle().promise();
+    Shard&         s     = shard(taskp);
 
-    tasks.push_back(move(task));
-    ready.notify_one();
+    {
+        const Lock lock{s.mutex};
+
+        s.tasks.push(taskp);
+        task.release();
+    }
+
+    /*
+        Now that the task can be found, allow it to be notified (and
+        subsequently released) by unlocking it.
+    */
+    taskp->unlock();
 }
 
 
 Task
-Scheduler::Task_queue::try_pop()
+Scheduler::Waiting_tasks::release(Task::Promise* taskp)
 {
     Task        task;
-    const Lock  lock{mutex, try_to_lock};
+    Shard&      s = shard(taskp);
+    const Lock  lock{s.mutex};
 
-    if (lock && !tasks.empty())
-        task = pop_front(&tasks);
+    if (s.tasks.erase(taskp))
+        task = Task{Task::Handle::from_promise(*taskp)};
 
     return task;
 }
 
 
-bool
-Scheduler::Task_queue::try_push(Task&& task)
+inline Scheduler::Waiting_tasks::Shard&
+Scheduler::Waiting_tasks::shard(Task::Promise* taskp)
 {
-    bool        is_pushed{false};
-    const Lock  lock{mutex, try_to_lock};
-
-    if (lock) {
-        tasks.push_back(move(task));
-        ready.notify_one();
-        is_pushed = true;
-    }
+    // Discard the low-order bits, which are mostly fixed by alignment.
+    const auto n = reinterpret_cast<std::uintptr_t>(taskp) >> 6;
 
-    return is_pushed;
+    return shards[n % nshards];
 }
 
 
 /*
-    Scheduler Task Queues
+    Scheduler Task Deque Array
 */
-Scheduler::Task_queues::Task_queues(Size n)
-    : qs{n}
+Scheduler::Task_deque::Array::Array(Index n)
+    : mask{n - 1}
+    , slots{new Slot[static_cast<std::size_t>(n)]}
 {
+    assert(n > 0 && (n & (n - 1)) == 0);
 }
 
 
-void
-Scheduler::Task_queues::interrupt()
+inline void*
+Scheduler::Task_deque::Array::get(Index i) const
 {
-    for (auto& q : qs)
-        q.interrupt();
+    return slots[i & mask].load(memory_order_relaxed);
 }
 
 
-Task
-Scheduler::Task_queues::pop(Size qpref)
+Scheduler::Task_deque::Array_ptr
+Scheduler::Task_deque::Array::grow(Index top, Index bottom) const
 {
-    Task task;
-
-    // Try to dequeue a task without waiting.
-    for (Size i = 0, nqs = qs.size(); i < nqs && !task; ++i) {
-        auto pos = (qpref + i) % nqs;
-        task = qs[pos].try_pop();
-    }
+    Array_ptr newp{new Array{size() * 2}};
 
-    // If that failed, wait on the preferred queue.
-    if (!task)
-        task = qs[qpref].pop();
+    for (Index i = top; i != bottom; ++i)
+        newp->put(i, get(i));
 
-    return task;
+    return newp;
 }
 
 
 inline void
-Scheduler::Task_queues::push(Task&& task)
+Scheduler::Task_deque::Array::put(Index i, void* taskp)
 {
-    const auto nqs = qs.size();
-    const auto qpref = nextq++ % nqs;
-
-    push(&qs, qpref, move(task));
+    slots[i & mask].store(taskp, memory_order_relaxed);
 }
 
 
-inline void
-Scheduler::Task_queues::push(Size qpref, Task&& task)
+inline Scheduler::Task_deque::Index
+Scheduler::Task_deque::Array::size() const
 {
-    push(&qs, qpref, move(task));
+    return mask + 1;
 }
 
 
-void
-Scheduler::Task_queues::push(Queue_vector* qvecp, Size qpref, Task&& task)
+/*
+    Scheduler Task Deque
+
+    The memory orderings follow Le, Pop, Cohen, and Zappa Nardelli,
+    "Correct and Efficient Work-Stealing for Weak Memory Models" (2013).
+*/
+Scheduler::Task_deque::Task_deque()
+    : top{0}
+    , bottom{0}
 {
-    Queue_vector&   qs  = *qvecp;
-    const auto      nqs = qs.size();
-    Size            i   = 0;
+    arrays.push_back(Array_ptr{new Array{initial_size}});
+    arrayp.store(arrays.back().get(), memory_order_relaxed);
+}
 
-    // Try to enqueue the task without waiting.
-    for (; i < nqs; ++i) {
-        auto pos = (qpref + i) % nqs;
-        if (qs[pos].try_push(move(task)))
-            break;
-    }
 
-    // If that failed, wait on the preferred queue.
-    if (i == nqs)
-        qs[qpref].push(move(task));
+Scheduler::Task_deque::~Task_deque()
+{
+    // Destroy the tasks that never ran.
+    while (pop())
+        ;
 }
 
 
-inline Scheduler::Task_queues::Size
-Scheduler::Task_queues::size() const
+inline bool
+Scheduler::Task_deque::is_empty() const
 {
-    return qs.size();
+    return bottom.load(memory_order_acquire) <= top.load(memory_order_acquire);
 }
 
 
-/*
-    Scheduler Unlock Sentry
-*/
-inline
-Scheduler::Unlock_sentry::Unlock_sentry(Lock* lp)
-    : lockp{lp}
+inline Task
+Scheduler::Task_deque::make_task(void* taskp)
 {
-    lockp->unlock();
+    return Task{Task::Handle::from_address(taskp)};
 }
 
 
-inline
-Scheduler::Unlock_sentry::~Unlock_sentry()
+Task
+Scheduler::Task_deque::pop()
 {
-    lockp->lock();
+    const Index b   = bottom.load(memory_order_relaxed) - 1;
+    Array*      ap  = arrayp.load(memory_order_relaxed);
+    void*       p   = nullptr;
+
+    bottom.store(b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    Index t = top.load(memory_order_relaxed);
+
+    if (t <= b) {
+        p = ap->get(b);
+        if (t == b) {
+            // The last task could be contested by a thief.
+            if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+                p = nullptr;
+            bottom.store(b + 1, memory_order_relaxed);
+        }
+    } else
+        bottom.store(b + 1, memory_order_relaxed);
+
+    return make_task(p);
 }
 
 
-/*
-    Scheduler Timers Alarm Queue
-*/
-inline Scheduler::Timers::Alarm_queue::Iterator
-Scheduler::Timers::Alarm_queue::begin()
+void
+Scheduler::Task_deque::push(Task&& task)
 {
-    return alarms.begin();
+    const Index b   = bottom.load(memory_order_relaxed);
+    const Index t   = top.load(memory_order_acquire);
+    Array*      ap  = arrayp.load(memory_order_relaxed);
+
+    if (b - t > ap->size() - 1) {
+        arrays.push_back(ap->grow(t, b));
+        ap = arrays.back().get();
+        arrayp.store(ap, memory_order_release);
+    }
+
+    ap->put(b, task.release().address());
+    atomic_thread_fence(memory_order_release);
+    bottom.store(b + 1, memory_order_relaxed);
 }
 
 
-inline Scheduler::Timers::Alarm_queue::Iterator
-Scheduler::Timers::Alarm_queue::end()
+Task
+Scheduler::Task_deque::steal()
 {
-    return alarms.end();
-}
+    Index t = top.load(memory_order_acquire);
 
+    atomic_thread_fence(memory_order_seq_cst);
 
-inline void
-Scheduler::Timers::Alarm_queue::erase(Iterator p)
+    const Index b = bottom.load(memory_order_acquire);
+    void*       p = nullptr;
+
+    if (t < b) {
+        const Array* ap = arrayp.load(memory_order_acquire);
+
+        p = ap->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            p = nullptr; // lost the race to the owner or another thief
+    }
+
+    return make_task(p);
+}
+
+
+/*
+    Scheduler Task Queue
+*/
+inline bool
+Scheduler::Task_queue::is_empty() const
+{
+    return ntasks.load(memory_order_acquire) == 0;
+}
+
+
+inline Task
+Scheduler::Task_queue::pop_front(std::deque<Task>* tasksp)
+{
+    Task task{move(tasksp->front())};
+
+    tasksp->pop_front();
+    return task;
+}
+
+
+void
+Scheduler::Task_queue::push(Task&& task)
+{
+    const Lock lock{mutex};
+
+    tasks.push_back(move(task));
+    ntasks.store(tasks.size(), memory_order_release);
+}
+
+
+Task
+Scheduler::Task_queue::try_pop()
+{
+    Task task;
+
+    // Avoid the lock if there's obviously nothing to pop.
+    if (!is_empty()) {
+        const Lock lock{mutex};
+
+        if (!tasks.empty()) {
+            task = pop_front(&tasks);
+            ntasks.store(tasks.size(), memory_order_release);
+        }
+    }
+
+    return task;
+}
+
+
+/*
+    Scheduler Task Slot
+*/
+Scheduler::Task_slot::~Task_slot()
+{
+    // Destroy a task that never ran.
+    take();
+}
+
+
+Task
+Scheduler::Task_slot::exchange(Task&& task)
+{
+    void* p = taskp.exchange(task.release().address(), memory_order_acq_rel);
+    return Task{Task::Handle::from_address(p)};
+}
+
+
+Task
+Scheduler::Task_slot::take()
+{
+    // Avoid the exchange if there's obviously nothing to take.
+    void* p = taskp.load(memory_order_relaxed);
+
+    if (p)
+        p = taskp.exchange(nullptr, memory_order_acq_rel);
+
+    return Task{Task::Handle::from_address(p)};
+}
+
+
+/*
+    Scheduler Task Queues
+*/
+Scheduler::Task_queues::Task_queues(Timer_vector* tsp)
+    : nworkers{tsp->size()}
+    , nodes(tsp->size(), 0)
+    , deques{tsp->size() * nlanes}
+    , slots(tsp->size())
+    , timersp{tsp}
+    , idlers(tsp->size())
+    , idletop{tsp->size()}
+{
+}
+
+
+inline unsigned
+Scheduler::Task_queues::node(Size q) const
+{
+    return nodes[q];
+}
+
+
+void
+Scheduler::Task_queues::place(Size q, unsigned node)
+{
+    nodes[q] = node;
+}
+
+
+void
+Scheduler::Task_queues::attach(Size q)
+{
+    Worker& self = this_worker();
+
+    self.queuesp    = this;
+    self.queue      = q;
+    self.ticks      = 0;
+    self.random.seed(std::random_device{}());
+}
+
+
+void
+Scheduler::Task_queues::interrupt()
+{
+    is_interrupt = true;
+    for (const auto& timers : *timersp)
+        timers.interrupt();
+}
+
+
+/*
+    The next slots are ignored because their owners are running and will
+    get to them (or spinning workers will take them).
+*/
+bool
+Scheduler::Task_queues::is_empty() const
+{
+    for (const auto& q : global) {
+        if (!q.is_empty())
+            return false;
+    }
+
+    if (!yielded.is_empty())
+        return false;
+
+    for (const auto& d : deques) {
+        if (!d.is_empty())
+            return false;
+    }
+
+    return true;
+}
+
+
+inline void
+Scheduler::Task_queues::notify()
+{
+    /*
+        The fence orders the caller's push before the check for idle
+        workers (and pairs with the fence in wait()), so that either an
+        idle worker sees the task or this thread sees the idle worker.
+    */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (nspinning.load(memory_order_relaxed) > 0 || nidle.load(memory_order_relaxed) == 0)
+        return;
+
+    // Become the only waker by making the sleeper a spinner on its behalf.
+    int nspin = 0;
+    if (!nspinning.compare_exchange_strong(nspin, 1))
+        return;
+
+    Size q;
+
+    {
+        const Lock lock{mutex};
+        q = pop_idle();
+    }
+
+    if (q != nworkers)
+        (*timersp)[q].interrupt();
+    else
+        nspinning.fetch_sub(1);
+}
+
+
+inline Scheduler::Task_queues::Size
+Scheduler::Task_queues::pop_idle()
+{
+    const Size q = idletop;
+
+    if (q != nworkers)
+        erase_idle(q);
+
+    return q;
+}
+
+
+inline void
+Scheduler::Task_queues::push_idle(Size q)
+{
+    Idle_link& link = idlers[q];
+
+    link.prev       = nworkers;
+    link.next       = idletop;
+    link.is_idle    = true;
+    if (idletop != nworkers)
+        idlers[idletop].prev = q;
+    idletop = q;
+    ++nidle;
+}
+
+
+inline void
+Scheduler::Task_queues::erase_idle(Size q)
+{
+    Idle_link& link = idlers[q];
+
+    if (link.prev != nworkers)
+        idlers[link.prev].next = link.next;
+    else
+        idletop = link.next;
+
+    if (link.next != nworkers)
+        idlers[link.next].prev = link.prev;
+
+    link.is_idle = false;
+    --nidle;
+}
+
+
+inline Scheduler::Task_deque&
+Scheduler::Task_queues::deque(Size q, Size l)
+{
+    return deques[q*nlanes + l];
+}
+
+
+inline Scheduler::Task_queues::Size
+Scheduler::Task_queues::lane(Task_priority prio)
+{
+    const Size l = static_cast<Size>(prio);
+
+    assert(l < nlanes);
+    return l;
+}
+
+
+/*
+    Under the weighted policy, each period of lane ticks begins with the
+    lane favored for that tick (the critical lane for its weight in ticks,
+    then the normal lane and the background lane for theirs), followed by
+    the remaining lanes in priority order.
+*/
+void
+Scheduler::Task_queues::order_lanes(Worker* selfp, Size* lanesp) const
+{
+    Size first = lane(Task_priority::critical);
+
+    if (policy() == Priority_policy::weighted) {
+        const unsigned tick = selfp->laneticks++ % lane_period;
+
+        if (tick < critical_weight)
+            first = lane(Task_priority::critical);
+        else if (tick < critical_weight + normal_weight)
+            first = lane(Task_priority::normal);
+        else
+            first = lane(Task_priority::background);
+    }
+
+    *lanesp++ = first;
+    for (Size l = 0; l < nlanes; ++l) {
+        if (l != first)
+            *lanesp++ = l;
+    }
+}
+
+
+Task
+Scheduler::Task_queues::pop(Size q)
+{
+    Worker* selfp = &this_worker();
+
+    assert(selfp->queuesp == this && selfp->queue == q);
+
+    Task task = try_pop(selfp);
+
+    while (!task) {
+        if (selfp->is_spinning || start_spinning(selfp))
+            task = spin(selfp);
+
+        if (!task) {
+            stop_spinning(selfp, false);
+            if (!wait(selfp))
+                break;
+            task = try_pop(selfp);
+        }
+    }
+
+    stop_spinning(selfp, task ? true : false);
+    return task;
+}
+
+
+Task
+Scheduler::Task_queues::spin(Worker* selfp)
+{
+    Task task;
+
+    for (int i = 0; i < spin_rounds && !task && !is_interrupt; ++i) {
+        std::this_thread::yield();
+        task = try_pop(selfp);
+    }
+
+    if (!task && !is_interrupt)
+        task = steal_next(selfp);
+
+    return task;
+}
+
+
+bool
+Scheduler::Task_queues::start_spinning(Worker* selfp)
+{
+    int nspin = nspinning.load(memory_order_relaxed);
+
+    // Limit the spinners to half of the workers.
+    while (2 * static_cast<Size>(nspin) < nworkers) {
+        if (nspinning.compare_exchange_weak(nspin, nspin + 1)) {
+            selfp->is_spinning = true;
+            break;
+        }
+    }
+
+    return selfp->is_spinning;
+}
+
+
+void
+Scheduler::Task_queues::stop_spinning(Worker* selfp, bool is_found)
+{
+    if (selfp->is_spinning) {
+        selfp->is_spinning = false;
+
+        // The last spinner to find a task wakes a replacement if more remain.
+        if (nspinning.fetch_sub(1) == 1 && is_found && !is_empty())
+            notify();
+    }
+}
+
+
+inline Scheduler::Priority_policy
+Scheduler::Task_queues::policy() const
+{
+    return lanepolicy.load(memory_order_relaxed);
+}
+
+
+inline void
+Scheduler::Task_queues::policy(Priority_policy p)
+{
+    lanepolicy.store(p, memory_order_relaxed);
+}
+
+
+void
+Scheduler::Task_queues::push(Task&& task)
+{
+    const Worker&   self    = this_worker();
+    const Size      l       = lane(task.handle().promise().priority());
+
+    // Only the owner of a deque can push to it.
+    if (self.queuesp == this)
+        deque(self.queue, l).push(move(task));
+    else
+        global[l].push(move(task));
+
+    notify();
+}
+
+
+void
+Scheduler::Task_queues::push_next(Task&& task)
+{
+    const Worker& self = this_worker();
+
+    // Only a worker can hand off to itself.
+    if (self.queuesp != this) {
+        push(move(task));
+        return;
+    }
+
+    if (Task prev = slots[self.queue].exchange(move(task))) {
+        const Size l = lane(prev.handle().promise().priority());
+        deque(self.queue, l).push(move(prev));
+    }
+
+    notify();
+}
+
+
+inline Scheduler::Task_queues::Size
+Scheduler::Task_queues::size() const
+{
+    return nworkers;
+}
+
+
+Task
+Scheduler::Task_queues::steal(Worker* selfp, Size l)
+{
+    Task        task;
+    const Size  n = nworkers;
+
+    if (n > 1) {
+        const Size      first   = selfp->random() % n;
+        const unsigned  home    = nodes[selfp->queue];
+
+        // Try the workers on the same NUMA node before the others.
+        for (int pass = 0; pass < 2 && !task; ++pass) {
+            for (Size i = 0; i < n && !task; ++i) {
+                const Size victim = (first + i) % n;
+                if (victim != selfp->queue && (nodes[victim] == home) == (pass == 0))
+                    task = deque(victim, l).steal();
+            }
+        }
+    }
+
+    return task;
+}
+
+
+Task
+Scheduler::Task_queues::steal_next(Worker* selfp)
+{
+    Task        task;
+    const Size  n = nworkers;
+
+    if (n > 1) {
+        const Size first = selfp->random() % n;
+
+        for (Size i = 0; i < n && !task; ++i) {
+            const Size victim = (first + i) % n;
+            if (victim != selfp->queue)
+                task = slots[victim].take();
+        }
+    }
+
+    return task;
+}
+
+
+inline Scheduler::Task_queues::Size
+Scheduler::Task_queues::this_queue() const
+{
+    const Worker& self = this_worker();
+    return self.queuesp == this ? self.queue : nworkers;
+}
+
+
+inline Scheduler::Task_queues::Worker&
+Scheduler::Task_queues::this_worker()
+{
+    static thread_local Worker self;
+    return self;
+}
+
+
+Task
+Scheduler::Task_queues::try_pop(Worker* selfp)
+{
+    Task        task;
+    bool        is_next = false;
+    Task_slot&  slot    = slots[selfp->queue];
+    Size        lanes[nlanes];
+
+    order_lanes(selfp, lanes);
+
+    // Check the shared queues periodically so they can't be starved.
+    if (++selfp->ticks % global_interval == 0) {
+        for (Size i = 0; i < nlanes && !task; ++i)
+            task = global[lanes[i]].try_pop();
+
+        if (!task)
+            task = yielded.try_pop();
+    }
+
+    // The next slot goes behind the lanes once it has had its run.
+    if (!task && selfp->nexts < next_limit) {
+        task = slot.take();
+        is_next = task ? true : false;
+    }
+
+    for (Size i = 0; i < nlanes && !task; ++i) {
+        task = deque(selfp->queue, lanes[i]).pop();
+        if (!task)
+            task = global[lanes[i]].try_pop();
+    }
+
+    if (!task) {
+        task = slot.take();
+        is_next = task ? true : false;
+    }
+
+    selfp->nexts = is_next ? selfp->nexts + 1 : 0;
+
+    for (Size i = 0; i < nlanes && !task; ++i)
+        task = steal(selfp, lanes[i]);
+
+    if (!task)
+        task = yielded.try_pop();
+
+    return task;
+}
+
+
+bool
+Scheduler::Task_queues::wait(Worker* selfp)
+{
+    const Size q = selfp->queue;
+
+    {
+        const Lock lock{mutex};
+        push_idle(q);
+    }
+
+    /*
+        The fence orders the registration before the check for tasks (and
+        pairs with the fence in notify()), so that either this worker sees
+        the task or the notifier sees this worker.  Parking also returns
+        when one of the worker's alarms expires, or spuriously if a wakeup
+        arrived after the worker stopped waiting, so the caller retries.
+    */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!is_interrupt && is_empty())
+        (*timersp)[q].wait();
+
+    /*
+        A worker that's no longer on the idle stack was woken by a push,
+        which counted it as spinning.  Otherwise it woke by itself (e.g.,
+        for an alarm).
+    */
+    {
+        const Lock lock{mutex};
+
+        if (idlers[q].is_idle)
+            erase_idle(q);
+        else
+            selfp->is_spinning = true;
+    }
+
+    return !is_interrupt;
+}
+
+
+void
+Scheduler::Task_queues::yield(Task&& task)
+{
+    yielded.push(move(task));
+    notify();
+}
+
+
+/*
+    Scheduler Unlock Sentry
+*/
+inline
+Scheduler::Unlock_sentry::Unlock_sentry(Lock* lp)
+    : lockp{lp}
+{
+    lockp->unlock();
+}
+
+
+inline
+Scheduler::Unlock_sentry::~Unlock_sentry()
+{
+    lockp->lock();
+}
+
+
+/*
+    Scheduler Timers Alarm Queue
+*/
+inline void
+Scheduler::Timers::Alarm_queue::attach(std::uint32_t worker)
+{
+    owner = worker;
+}
+
+
+Scheduler::Timers::Alarm_queue::Index
+Scheduler::Timers::Alarm_queue::allocate(Alarm&& alarm)
+{
+    Index i;
+
+    if (freeslots.empty()) {
+        i = static_cast<Index>(slots.size());
+        slots.emplace_back();
+    } else {
+        i = freeslots.back();
+        freeslots.pop_back();
+    }
+
+    Slot& slot = slots[i];
+    slot.alarm = move(alarm);
+    slot.is_used = true;
+    if (++slot.serial == 0)
+        slot.serial = 1;
+
+    return i;
+}
+
+
+bool
+Scheduler::Timers::Alarm_queue::erase(Alarm_id id)
+{
+    const Slot* slotp = lookup(id);
+
+    if (!slotp)
+        return false;
+
+    remove(slotp->pos);
+    release(id.slot());
+    return true;
+}
+
+
+inline Time
+Scheduler::Timers::Alarm_queue::expiry(Position pos) const
+{
+    return slots[heap[pos]].alarm.time;
+}
+
+
+inline const Scheduler::Timers::Alarm&
+Scheduler::Timers::Alarm_queue::front() const
+{
+    return slots[heap.front()].alarm;
+}
+
+
+inline bool
+Scheduler::Timers::Alarm_queue::is_empty() const
+{
+    return heap.empty();
+}
+
+
+inline Scheduler::Timers::Alarm_queue::Slot*
+Scheduler::Timers::Alarm_queue::lookup(Alarm_id id)
+{
+    const auto& self = *this;
+    return const_cast<Slot*>(self.lookup(id));
+}
+
+
+inline const Scheduler::Timers::Alarm_queue::Slot*
+Scheduler::Timers::Alarm_queue::lookup(Alarm_id id) const
+{
+    const Index i = id.slot();
+
+    if (id.worker() == owner && i < slots.size()) {
+        const Slot& slot = slots[i];
+        if (slot.is_used && slot.serial == id.serial())
+            return &slot;
+    }
+
+    return nullptr;
+}
+
+
+inline Time
+Scheduler::Timers::Alarm_queue::next_expiry() const
+{
+    return front().time;
+}
+
+
+inline void
+Scheduler::Timers::Alarm_queue::place(Position pos, Index i)
+{
+    heap[pos] = i;
+    slots[i].pos = pos;
+}
+
+
+Scheduler::Timers::Alarm
+Scheduler::Timers::Alarm_queue::pop()
+{
+    const Index i = heap.front();
+    Alarm       a = move(slots[i].alarm);
+
+    remove(0);
+    release(i);
+    return a;
+}
+
+
+Alarm_id
+Scheduler::Timers::Alarm_queue::push(Alarm&& alarm)
+{
+    const Index     i   = allocate(move(alarm));
+    const Position  pos = heap.size();
+
+    heap.push_back(i);
+    slots[i].pos = pos;
+    sift_up(pos);
+    return Alarm_id{owner, i, slots[i].serial};
+}
+
+
+inline void
+Scheduler::Timers::Alarm_queue::release(Index i)
+{
+    Slot& slot = slots[i];
+
+    slot.alarm = Alarm();   // drop the channel reference
+    slot.is_used = false;
+    freeslots.push_back(i);
+}
+
+
+void
+Scheduler::Timers::Alarm_queue::remove(Position pos)
+{
+    const Index last = heap.back();
+
+    heap.pop_back();
+    if (pos < heap.size()) {
+        place(pos, last);
+        restore(pos);
+    }
+}
+
+
+bool
+Scheduler::Timers::Alarm_queue::reschedule(Alarm_id id, Time expiry)
+{
+    Slot* slotp = lookup(id);
+
+    if (!slotp)
+        return false;
+
+    slotp->alarm.time = expiry;
+    restore(slotp->pos);
+    return true;
+}
+
+
+inline void
+Scheduler::Timers::Alarm_queue::restore(Position pos)
+{
+    if (pos > 0 && expiry(pos) < expiry((pos - 1) / arity))
+        sift_up(pos);
+    else
+        sift_down(pos);
+}
+
+
+void
+Scheduler::Timers::Alarm_queue::sift_down(Position pos)
+{
+    const Index     i       = heap[pos];
+    const Time      time    = slots[i].alarm.time;
+    const Position  n       = heap.size();
+
+    for (Position first = pos * arity + 1; first < n; first = pos * arity + 1) {
+        const Position  last = std::min(first + arity, n);
+        Position        min  = first;
+
+        for (Position child = first + 1; child < last; ++child) {
+            if (expiry(child) < expiry(min))
+                min = child;
+        }
+
+        if (!(expiry(min) < time))
+            break;
+
+        place(pos, heap[min]);
+        pos = min;
+    }
+
+    place(pos, i);
+}
+
+
+void
+Scheduler::Timers::Alarm_queue::sift_up(Position pos)
+{
+    const Index i       = heap[pos];
+    const Time  time    = slots[i].alarm.time;
+
+    while (pos > 0) {
+        const Position parent = (pos - 1) / arity;
+
+        if (!(time < expiry(parent)))
+            break;
+
+        place(pos, heap[parent]);
+        pos = parent;
+    }
+
+    place(pos, i);
+}
+
+
+inline int
+Scheduler::Timers::Alarm_queue::size() const
+{
+    return static_cast<int>(heap.size());
+}
+
+
+/*
+    Scheduler Timers Alarm Clock
+*/
+void
+Scheduler::Timers::Alarm_clock::cancel()
+{
+    if (deadline) {
+        disarm();
+        deadline.reset();
+    }
+}
+
+
+void
+Scheduler::Timers::Alarm_clock::set(Time expiry)
+{
+    // Avoid a system call if the deadline hasn't changed.
+    if (!deadline || *deadline != expiry) {
+        arm(expiry);
+        deadline = expiry;
+    }
+}
+
+
+Scheduler::Timers::Clock_event
+Scheduler::Timers::Alarm_clock::wait(Lock* lockp)
+{
+    Clock_event event;
+
+    {
+        const Unlock_sentry unlock{lockp};
+        event = wait_any();
+    }
+
+    // A one-shot timer is disarmed by its expiry.
+    if (event == Clock_event::alarm)
+        deadline.reset();
+
+    return event;
+}
+
+
+#if defined _WIN32
+
+Scheduler::Timers::Alarm_clock::Alarm_clock()
+    : hs{NULL, NULL}
+{
+    int n = 0;
+
+    /*
+        TODO:  Implement error handling for Windows APIs (perhaps using
+        std::system_error).
+    */
+    try {
+        assert(timer_handle == n);
+        hs[n++] = CreateWaitableTimer(NULL, FALSE, NULL);
+
+        assert(interrupt_handle == n);
+        hs[n++] = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+        assert(n == count);
+    }
+    catch (...) {
+        close();
+    }
+}
+
+
+Scheduler::Timers::Alarm_clock::~Alarm_clock()
+{
+    close();
+}
+
+
+void
+Scheduler::Timers::Alarm_clock::arm(Time expiry) const
+{
+    static const int nanosecs_per_tick = 100;
+
+    // Waitable timers measure absolute time on the system clock, so a
+    // steady deadline must be converted to a (negative) relative time.
+    const Duration      dt      = expiry - Clock::now();
+    const std::int64_t  timerdt = -(dt.count() / nanosecs_per_tick);
+    LARGE_INTEGER       timebuf;
+
+    timebuf.LowPart = static_cast<DWORD>(timerdt & 0xFFFFFFFF);
+    timebuf.HighPart = static_cast<LONG>(timerdt >> 32);
+    SetWaitableTimer(hs[timer_handle], &timebuf, 0, NULL, NULL, FALSE);
+}
+
+
+void
+Scheduler::Timers::Alarm_clock::close()
+{
+    for (int i = 0; i < count; ++i) {
+        HANDLE& h = hs[count-i - 1];
+        if (h) {
+            CloseHandle(h);
+            h = NULL;
+        }
+    }
+}
+
+
+inline void
+Scheduler::Timers::Alarm_clock::disarm() const
+{
+    CancelWaitableTimer(hs[timer_handle]);
+}
+
+
+void
+Scheduler::Timers::Alarm_clock::interrupt() const
+{
+    SetEvent(hs[interrupt_handle]);
+}
+
+
+Scheduler::Timers::Clock_event
+Scheduler::Timers::Alarm_clock::wait_any() const
+{
+    const DWORD n = WaitForMultipleObjects(count, hs, FALSE, INFINITE);
+
+    return n == WAIT_OBJECT_0 + timer_handle ? Clock_event::alarm : Clock_event::interrupt;
+}
+
+#else
+
+/*
+    Linux Implementation
+*/
+namespace {
+
+int
+check_fd(int fd, const char* what)
+{
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), what);
+
+    return fd;
+}
+
+
+void
+watch_fd(int epollfd, int fd)
+{
+    epoll_event event{};
+
+    event.events    = EPOLLIN;
+    event.data.fd   = fd;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event) < 0)
+        throw std::system_error(errno, std::system_category(), "epoll_ctl");
+}
+
+
+/*
+    Reads (and so resets) the counter of a timerfd or eventfd.  Returns
+    false if the counter was zero.
+*/
+bool
+drain_fd(int fd, const char* what)
+{
+    std::uint64_t   count;
+    ssize_t         n;
+
+    while ((n = ::read(fd, &count, sizeof count)) < 0) {
+        if (errno == EAGAIN)
+            return false;
+        if (errno != EINTR)
+            throw std::system_error(errno, std::system_category(), what);
+    }
+
+    return true;
+}
+
+
+void
+set_timerfd(int fd, const itimerspec& spec)
+{
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+        throw std::system_error(errno, std::system_category(), "timerfd_settime");
+}
+
+}   // namespace
+
+
+Scheduler::Timers::Alarm_clock::Alarm_clock()
+    : epollfd{-1}
+    , timerfd{-1}
+    , eventfd{-1}
+{
+    try {
+        epollfd = check_fd(epoll_create1(EPOLL_CLOEXEC), "epoll_create1");
+        timerfd = check_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC), "timerfd_create");
+        eventfd = check_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd");
+        watch_fd(epollfd, timerfd);
+        watch_fd(epollfd, eventfd);
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+
+Scheduler::Timers::Alarm_clock::~Alarm_clock()
+{
+    close();
+}
+
+
+void
+Scheduler::Timers::Alarm_clock::arm(Time expiry) const
+{
+    static const std::int64_t nanosecs_per_sec = 1000000000;
+
+    const std::int64_t  ns = std::chrono::duration_cast<Duration>(expiry.time_since_epoch()).count();
+    itimerspec          spec{};
+
+    // A zero expiry would disarm the timer rather than fire it.
+    if (ns > 0) {
+        spec.it_value.tv_sec    = static_cast<time_t>(ns / nanosecs_per_sec);
+        spec.it_value.tv_nsec   = static_cast<long>(ns % nanosecs_per_sec);
+    } else
+        spec.it_value.tv_nsec = 1;
+
+    set_timerfd(timerfd, spec);
+}
+
+
+void
+Scheduler::Timers::Alarm_clock::close()
+{
+    for (int* fdp : {&eventfd, &timerfd, &epollfd}) {
+        if (*fdp >= 0) {
+            ::close(*fdp);
+            *fdp = -1;
+        }
+    }
+}
+
+
+inline void
+Scheduler::Timers::Alarm_clock::disarm() const
+{
+    set_timerfd(timerfd, itimerspec{});
+}
+
+
+void
+Scheduler::Timers::Alarm_clock::interrupt() const
+{
+    const std::uint64_t one = 1;
+
+    while (::write(eventfd, &one, sizeof one) < 0 && errno == EINTR)
+        ;
+}
+
+
+Scheduler::Timers::Clock_event
+Scheduler::Timers::Alarm_clock::wait_any() const
+{
+    epoll_event events[2];
+    int         n;
+    bool        is_alarm{false};
+    bool        is_interrupt{false};
+
+    while ((n = epoll_wait(epollfd, events, 2, -1)) < 0) {
+        if (errno != EINTR)
+            throw std::system_error(errno, std::system_category(), "epoll_wait");
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (events[i].data.fd == timerfd)
+            is_alarm = true;
+        else
+            is_interrupt = true;
+    }
+
+    /*
+        Drain the counters so that the events don't remain pending.  The
+        timer's counter can be zero if it was rearmed after epoll reported
+        it, in which case the alarm is spurious and is reported as an
+        interrupt (which is harmless, since the worker checks the time).
+    */
+    if (is_alarm)
+        is_alarm = drain_fd(timerfd, "read timerfd");
+
+    if (is_interrupt)
+        drain_fd(eventfd, "read eventfd");
+
+    return is_alarm ? Clock_event::alarm : Clock_event::interrupt;
+}
+
+#endif
+
+
+/*
+    Scheduler Timers
+*/
+inline void
+Scheduler::Timers::attach(std::uint32_t worker)
+{
+    alarmq.attach(worker);
+}
+
+
+bool
+Scheduler::Timers::cancel(Alarm_id id)
+{
+    const Lock lock{mutex};
+
+    if (!alarmq.erase(id))
+        return false;
+
+    update_clock();
+    return true;
+}
+
+
+inline void
+Scheduler::Timers::interrupt() const
+{
+    clock.interrupt();
+}
+
+
+inline bool
+Scheduler::Timers::is_ready(const Alarm& alarm, Time now)
+{
+    return alarm.time <= now;
+}
+
+
+inline bool
+Scheduler::Timers::is_ready(Duration::rep expiry, Time now)
+{
+    return expiry != never && expiry <= now.time_since_epoch().count();
+}
+
+
+inline bool
+Scheduler::Timers::notify_timer_expired(Task::Promise* taskp, Time now, Lock* lockp)
+{
+    /*
+        Timer cancellation can race with timer expiration, so unlock the
+        timers before notifying the task that its timer has expired.
+    */
+    const Unlock_sentry unlock{lockp};
+    return taskp->notify_timer_expired(now);
+}
+
+
+void
+Scheduler::Timers::process_ready()
+{
+    /*
+        The owning worker calls this between tasks, so avoid the lock
+        (and the clock) unless an alarm is known to be pending.
+    */
+    if (nextexpiry.load(memory_order_relaxed) != never) {
+        const auto now = Clock::now();
+
+        if (is_ready(nextexpiry.load(memory_order_relaxed), now)) {
+            Lock lock{mutex};
+            signal_ready(&alarmq, now, &lock);
+            update_clock();
+        }
+    }
+}
+
+
+bool
+Scheduler::Timers::reset(Alarm_id id, Duration duration)
+{
+    const Lock lock{mutex};
+
+    // An alarm that's still queued hasn't fired, so reschedule it in place.
+    if (!alarmq.reschedule(id, Clock::now() + duration))
+        return false;
+
+    update_clock();
+    return true;
+}
+
+
+inline void
+Scheduler::Timers::signal_alarm(Task::Promise* taskp, Time now, Lock* lockp)
+{
+    if (notify_timer_expired(taskp, now, lockp))
+        taskp->owner()->resume(taskp);
+}
+
+
+inline void
+Scheduler::Timers::signal_alarm(const Time_channel& chan, Time now)
+{
+    chan.try_send(now);
+}
+
+
+void
+Scheduler::Timers::signal_ready(const Alarm& alarm, Time now, Lock* lockp)
+{
+    if (alarm.taskp)
+        signal_alarm(alarm.taskp, now, lockp);
+    else
+        signal_alarm(alarm.channel, now);
+}
+
+
+void
+Scheduler::Timers::signal_ready(Alarm_queue* qp, Time now, Lock* lockp)
+{
+    while (!qp->is_empty() && is_ready(qp->front(), now))
+        signal_ready(qp->pop(), now, lockp);
+}
+
+
+Alarm_id
+Scheduler::Timers::start(Task::Promise* taskp, Duration duration)
+{
+    const Lock lock{mutex};
+
+    return start_alarm(Alarm{taskp, Clock::now() + duration});
+}
+
+
+Alarm_id
+Scheduler::Timers::start(const Time_channel& chan, Duration duration)
+{
+    const Lock lock{mutex};
+
+    return start_alarm(Alarm{chan, Clock::now() + duration});
+}
+
+
+inline Alarm_id
+Scheduler::Timers::start_alarm(Alarm&& alarm)
+{
+    const Alarm_id id = alarmq.push(move(alarm));
+
+    update_clock();
+    return id;
+}
+
+
+bool
+Scheduler::Timers::stop(Alarm_id id)
+{
+    return cancel(id);
+}
+
+
+/*
+    Publish the next expiry for the owning worker.  The alarm clock is only
+    needed while the worker is parked, so it's armed lazily (by wait()) to
+    spare a busy worker the system calls.
+*/
+void
+Scheduler::Timers::update_clock()
+{
+    if (alarmq.is_empty()) {
+        nextexpiry.store(never, memory_order_relaxed);
+        clock.cancel();
+    } else {
+        const Time next = alarmq.next_expiry();
+
+        nextexpiry.store(next.time_since_epoch().count(), memory_order_relaxed);
+        if (is_parked)
+            clock.set(next);
+    }
+}
+
+
+void
+Scheduler::Timers::wait()
+{
+    Lock lock{mutex};
+
+    is_parked = true;
+    update_clock();
+    clock.wait(&lock);
+    is_parked = false;
+
+    signal_ready(&alarmq, Clock::now(), &lock);
+    update_clock();
+}
+
+
+/*
+    Scheduler Frame Pool
+*/
+Scheduler::Frame_pool::~Frame_pool()
+{
+    for (auto& bin : bins) {
+        while (Frame* framep = bin.headp) {
+            bin.headp = framep->nextp;
+            ::operator delete(framep);
+        }
+    }
+}
+
+
+void*
+Scheduler::Frame_pool::allocate(std::size_t n)
+{
+    const std::size_t c = size_class(n);
+
+    count(&nallocs);
+    if (c < nclasses) {
+        Bin& bin = bins[c];
+
+        if (Frame* framep = bin.headp) {
+            bin.headp = framep->nextp;
+            --bin.size;
+            count(&nhits);
+            return framep;
+        }
+    }
+
+    return ::operator new(block_size(n));
+}
+
+
+std::size_t
+Scheduler::Frame_pool::block_size(std::size_t n)
+{
+    const std::size_t c = size_class(n);
+    return c < nclasses ? class_size(c) : n;
+}
+
+
+inline std::size_t
+Scheduler::Frame_pool::class_size(std::size_t c)
+{
+    return (c + 1) * cache_line_size;
+}
+
+
+/*
+    Only the owning worker updates the counters, so a full read-modify-
+    write isn't needed.
+*/
+inline void
+Scheduler::Frame_pool::count(std::atomic<std::uint64_t>* np)
+{
+    np->store(np->load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+
+bool
+Scheduler::Frame_pool::deallocate(void* p, std::size_t n)
+{
+    const std::size_t c = size_class(n);
+
+    if (c >= nclasses || bins[c].size == bin_capacity)
+        return false;
+
+    Bin&    bin     = bins[c];
+    Frame*  framep  = static_cast<Frame*>(p);
+
+    framep->nextp = bin.headp;
+    bin.headp = framep;
+    ++bin.size;
+    return true;
+}
+
+
+inline std::size_t
+Scheduler::Frame_pool::size_class(std::size_t n)
 {
-    alarms.erase(p);
+    return n > 0 ? (n - 1) / cache_line_size : 0;
 }
 
 
-template<class T>
-Scheduler::Timers::Alarm_queue::Iterator
-Scheduler::Timers::Alarm_queue::find(const T& id)
+Scheduler::Frame_statistics
+Scheduler::Frame_pool::statistics() const
 {
-    const auto first    = alarms.begin();
-    const auto last     = alarms.end();
-    const auto p        = find_if(first, last, id_eq(id));
-
-    return (p != last) ? p : last;
+    return {nallocs.load(memory_order_relaxed), nhits.load(memory_order_relaxed)};
 }
 
 
-inline const Scheduler::Timers::Alarm&
-Scheduler::Timers::Alarm_queue::front() const
+/*
+    Scheduler Node Pool
+*/
+void*
+Scheduler::Node_pool::allocate(std::size_t n)
 {
-    return alarms.front();
+    const Lock lock{mutex};
+    return pool.allocate(n);
 }
 
 
-inline Scheduler::Timers::Alarm_queue::Task_eq
-Scheduler::Timers::Alarm_queue::id_eq(Task::Promise* taskp)
+bool
+Scheduler::Node_pool::deallocate(void* p, std::size_t n)
 {
-    return Task_eq{taskp};
+    const Lock lock{mutex};
+    return pool.deallocate(p, n);
 }
 
 
-inline Scheduler::Timers::Alarm_queue::Channel_eq
-Scheduler::Timers::Alarm_queue::id_eq(const Time_channel& chan)
+/*
+    Scheduler Node Sentry
+*/
+Scheduler::Node_sentry::Node_sentry(Scheduler* schedp, Node_hint hint)
+    : prevhintp{this_node_hint()}
 {
-    return Channel_eq{chan};
+    const int node = hint.node();
+
+    if (node >= 0 && static_cast<unsigned>(node) < schedp->nnodes)
+        this_node_hint() = &schedp->nodepools[node];
 }
 
 
-inline bool
-Scheduler::Timers::Alarm_queue::is_empty() const
+Scheduler::Node_sentry::~Node_sentry()
 {
-    return alarms.empty();
+    this_node_hint() = prevhintp;
 }
 
 
-inline Time
-Scheduler::Timers::Alarm_queue::next_expiry() const
+/*
+    Scheduler Random Engine
+*/
+inline unsigned
+Scheduler::Random_engine::epoch() const
 {
-    return alarms.front().time;
+    return seedepoch;
 }
 
 
-inline Scheduler::Timers::Alarm
-Scheduler::Timers::Alarm_queue::pop()
+inline std::uint64_t
+Scheduler::Random_engine::operator()()
 {
-    Alarm a = move(alarms.front());
-
-    alarms.pop_front();
-    return a;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1d;
 }
 
 
-Scheduler::Timers::Alarm_queue::Iterator
-Scheduler::Timers::Alarm_queue::push(const Alarm& a)
+inline void
+Scheduler::Random_engine::seed(std::uint64_t s, unsigned epoch)
 {
-    const auto p = upper_bound(alarms.begin(), alarms.end(), a);
-    return alarms.insert(p, a);
+    state       = s ? s : 1;    // the state mustn't be zero
+    seedepoch   = epoch;
 }
 
 
-void
-Scheduler::Timers::Alarm_queue::reschedule(Iterator p, Time time)
-{
-    p->time = time;
-    sort(alarms.begin(), alarms.end());
+/*
+    Scheduler Worker Placement
+*/
+#if defined _WIN32
+
+/*
+    Only the processors of the process's group are used.
+*/
+Scheduler::Cpu_vector
+Scheduler::available_cpus()
+{
+    const unsigned  nbits = sizeof(DWORD_PTR) * CHAR_BIT;
+    DWORD_PTR       procmask;
+    DWORD_PTR       sysmask;
+    Cpu_vector      cpus;
+
+    if (GetProcessAffinityMask(GetCurrentProcess(), &procmask, &sysmask)) {
+        for (unsigned i = 0; i < nbits; ++i) {
+            if (procmask & (DWORD_PTR{1} << i)) {
+                UCHAR node;
+                if (!GetNumaProcessorNode(static_cast<UCHAR>(i), &node) || node == 0xFF)
+                    node = 0;
+                cpus.push_back({i, node});
+            }
+        }
+    }
+
+    return cpus;
 }
 
 
-int
-Scheduler::Timers::Alarm_queue::size() const
+void
+Scheduler::pin_this_thread(unsigned cpu)
 {
-    return static_cast<int>(alarms.size());
+    // Pinning is advisory, so failure is ignored.
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu);
 }
 
+#else
+
+namespace {
 
 /*
-    Scheduler Timers Windows Handles
+    Assigns a node to the CPUs in a node's list (e.g., "0-7,16-23").
 */
-Scheduler::Timers::Windows_handles::Windows_handles()
+void
+read_node_cpus(const std::string& path, unsigned node, std::vector<unsigned>* nodesp)
 {
-    int n = 0;
+    std::ifstream   file{path};
+    unsigned        first;
 
-    /*
-        TODO:  Implement error handling for Windows APIs (perhaps using
-        std::system_error).
-    */
-    try {
-        assert(timer_handle == n);
-        hs[n++] = CreateWaitableTimer(NULL, FALSE, NULL);
+    while (file >> first) {
+        unsigned last = first;
 
-        assert(interrupt_handle == n);
-        hs[n++] = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (file.peek() == '-') {
+            file.get();
+            file >> last;
+        }
 
-        assert(n == count);
-    }
-    catch (...) {
-        close(hs, n);
+        for (unsigned cpu = first; cpu <= last && cpu < nodesp->size(); ++cpu)
+            (*nodesp)[cpu] = node;
+
+        if (file.peek() == ',')
+            file.get();
     }
 }
 
-
-inline
-Scheduler::Timers::Windows_handles::~Windows_handles()
-{
-    close(hs);
-}   
+}   // namespace
 
 
-void
-Scheduler::Timers::Windows_handles::close(Windows_handle* hs, int n)
+Scheduler::Cpu_vector
+Scheduler::available_cpus()
 {
-    for (int i = 0; i < n; ++i)
-        CloseHandle(hs[n-i - 1]);
-}
+    static const char   nodedir[] = "/sys/devices/system/node";
+    cpu_set_t           cpuset;
+    Cpu_vector          cpus;
 
+    CPU_ZERO(&cpuset);
+    if (sched_getaffinity(0, sizeof cpuset, &cpuset) < 0)
+        throw std::system_error(errno, std::system_category(), "sched_getaffinity");
 
-inline void
-Scheduler::Timers::Windows_handles::signal_interrupt() const
-{
-    SetEvent(hs[interrupt_handle]);
-}
+    // Machines without NUMA support have no node directory (one node).
+    std::vector<unsigned> cpunodes(CPU_SETSIZE, 0);
+
+    if (DIR* dirp = opendir(nodedir)) {
+        while (const dirent* entryp = readdir(dirp)) {
+            unsigned node;
+            if (std::sscanf(entryp->d_name, "node%u", &node) == 1)
+                read_node_cpus(std::string(nodedir) + '/' + entryp->d_name + "/cpulist", node, &cpunodes);
+        }
+        closedir(dirp);
+    }
 
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpuset))
+            cpus.push_back({cpu, cpunodes[cpu]});
+    }
 
-inline Scheduler::Timers::Windows_handle
-Scheduler::Timers::Windows_handles::timer() const
-{
-    return hs[timer_handle];
+    return cpus;
 }
 
 
-inline int
-Scheduler::Timers::Windows_handles::wait_any(Lock* lockp) const 
+void
+Scheduler::pin_this_thread(unsigned cpu)
 {
-    const Unlock_sentry unlock{lockp};
-    const DWORD         n = WaitForMultipleObjects(count, hs, FALSE, INFINITE);
+    cpu_set_t cpuset;
 
-    return static_cast<int>(n - WAIT_OBJECT_0);
+    // Pinning is advisory, so failure is ignored.
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof cpuset, &cpuset);
 }
 
+#endif
+
 
 /*
-    Scheduler Timers
+    Scheduler
 */
-Scheduler::Timers::Timers()
-    : thread{[&]() { run_thread(); }}
-{
-}
+Scheduler::Scheduler(int nthreads, Worker_placement placement)
+    : timers(nthreads > 0 ? nthreads : Thread::hardware_concurrency())
+    , ready{&timers}
+    , pools(timers.size())
+    , randseed{std::random_device{}()}
+{
+    const auto  nqs = ready.size();
+    Cpu_vector  cpus;
+
+    if (placement == Worker_placement::pinned) {
+        cpus = available_cpus();
+        std::stable_sort(cpus.begin(), cpus.end(), [](const Cpu& x, const Cpu& y) {
+            return x.node < y.node;
+        });
+    }
 
+    for (unsigned q = 0; q != nqs; ++q) {
+        timers[q].attach(q);
+        if (!cpus.empty()) {
+            const unsigned node = cpus[q % cpus.size()].node;
+            ready.place(q, node);
+            nnodes = std::max(nnodes, node + 1);
+        }
+    }
 
-Scheduler::Timers::~Timers()
-{
-    handles.signal_interrupt();
-    thread.join();
+    nodepools.reset(new Node_pool[nnodes]);
+
+    threads.reserve(nqs);
+    for (unsigned q = 0; q != nqs; ++q) {
+        if (cpus.empty())
+            threads.emplace_back([&,q]{ run_tasks(q); });
+        else {
+            const unsigned cpu = cpus[q % cpus.size()].id;
+            threads.emplace_back([&,q,cpu]{ pin_this_thread(cpu); run_tasks(q); });
+        }
+    }
 }
 
 
-void
-Scheduler::Timers::cancel(Task::Promise* taskp)
+/*
+    TODO:  Could this destructor should be rendered unnecessary by
+    arranging for (a) workqueues to shutdown implicitly (in their
+    destructors) and (b) workqueues to be joined implicitly (in their
+    destructors)?
+*/
+Scheduler::~Scheduler()
 {
-    sync_cancel(taskp);
+    ready.interrupt();
+    for (auto& thread : threads)
+        thread.join();
 }
 
 
-bool
-Scheduler::Timers::cancel(Task::Promise* taskp, Alarm_queue::Iterator alarmp, Alarm_queue* queuep, Windows_handle timer)
+void*
+Scheduler::allocate_frame(std::size_t n)
 {
-    remove_canceled(alarmp, queuep, timer);
-    if (taskp->notify_timer_canceled())
-        scheduler.resume(taskp);
+    Node_pool* const hintp = this_node_hint();
 
-    return true;
+    // A worker on a node other than the hinted one borrows from its pool.
+    if (hintp && hintp != this_node_pool())
+        return hintp->allocate(n);
+
+    Frame_pool* poolp = this_frame_pool();
+    return poolp ? poolp->allocate(n) : ::operator new(Frame_pool::block_size(n));
 }
 
 
 bool
-Scheduler::Timers::cancel(Time_channel chan, Alarm_queue::Iterator alarmp, Alarm_queue* queuep, Windows_handle timer)
+Scheduler::cancel_timer(Alarm_id id)
 {
-    remove_canceled(alarmp, queuep, timer);
-    return chan.is_empty();
+    Timers* timersp = find_timers(id);
+    return timersp ? timersp->cancel(id) : false;
 }
 
 
-inline void
-Scheduler::Timers::cancel_timer(Windows_handle handle)
+void
+Scheduler::deallocate_frame(void* p, std::size_t n)
 {
-    CancelWaitableTimer(handle);
+    Frame_pool* poolp   = this_frame_pool();
+    Node_pool*  nodep   = this_node_pool();
+
+    if (poolp && poolp->deallocate(p, n))
+        return;
+
+    // A worker's overflow goes to its node's pool.
+    if (!(nodep && nodep->deallocate(p, n)))
+        ::operator delete(p);
 }
 
 
-inline bool
-Scheduler::Timers::is_ready(const Alarm& alarm, Time now)
+inline Scheduler::Timers*
+Scheduler::find_timers(Alarm_id id)
 {
-    return alarm.time <= now;
+    return (id && id.worker() < timers.size()) ? &timers[id.worker()] : nullptr;
 }
 
 
-inline bool
-Scheduler::Timers::notify_timer_expired(Task::Promise* taskp, Time now, Lock* lockp)
+Scheduler::Frame_statistics
+Scheduler::frame_statistics() const
 {
-    /*
-        Timer cancellation can race with timer expiration, so unlock the
-        timers before notifying the task that its timer has expired.
-    */
-    const Unlock_sentry unlock{lockp};
-    return taskp->notify_timer_expired(now);
+    Frame_statistics total{0, 0};
+
+    for (const auto& pool : pools) {
+        const Frame_statistics stats = pool.statistics();
+        total.allocations += stats.allocations;
+        total.hits += stats.hits;
+    }
+
+    return total;
 }
 
 
-void
-Scheduler::Timers::process_ready(Alarm_queue* queuep, Windows_handle timer, Lock* lockp)
+/*
+    The splitmix64 finalizer, which spreads a seed and a worker index over
+    all of the bits of a generator's state.
+*/
+inline std::uint64_t
+Scheduler::mix(std::uint64_t x)
 {
-    const auto now = Clock::now();
-
-    signal_ready(queuep, now, lockp);
-    if (!queuep->is_empty())
-        set_timer(timer, queuep->front(), now);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
 }
 
 
-void
-Scheduler::Timers::remove_canceled(Alarm_queue::Iterator alarmp, Alarm_queue* queuep, Windows_handle timer)
+/*
+    A generator is (re)seeded when the Scheduler has been seeded since the
+    generator last was.  The range is mapped onto by multiplication rather
+    than division (the upper bits of xorshift64* are its best).
+*/
+Channel_size
+Scheduler::random(Channel_size min, Channel_size max)
 {
-    // If the alarm is next to fire, update the timer.
-    if (alarmp == queuep->begin()) {
-        const auto nextp = next(alarmp);
-        if (nextp == queuep->end())
-            cancel_timer(timer);
-        else if (alarmp->time < nextp->time)
-            set_timer(timer, *nextp, Clock::now());
+    Random_engine&  engine  = this_random_engine();
+    const unsigned  epoch   = randepoch.load(memory_order_acquire);
+
+    if (engine.epoch() != epoch) {
+        const std::uint64_t worker = ready.this_queue();
+        engine.seed(mix(randseed.load(memory_order_relaxed) + 0x9e3779b97f4a7c15 * (worker + 1)), epoch);
     }
 
-    queuep->erase(alarmp);
+    const std::uint64_t range = max - min + 1;
+    return min + static_cast<Channel_size>(((engine() >> 32) * range) >> 32);
 }
 
 
-void
-Scheduler::Timers::reschedule(Alarm_queue::Iterator alarmp, Duration duration, Alarm_queue* queuep, Windows_handle timer)
+bool
+Scheduler::reset_timer(const Time_channel& chan, Alarm_id* idp, Duration duration)
 {
-    const auto old = queuep->next_expiry();
-    const auto now = Clock::now();
-    
-    queuep->reschedule(alarmp, now + duration);
-    if (queuep->next_expiry() != old)
-        set_timer(timer, queuep->front(), now);
+    Timers* timersp = find_timers(*idp);
+
+    if (timersp && timersp->reset(*idp, duration))
+        return true;
+
+    // The alarm has fired, so start a new one.
+    *idp = this_timers().start(chan, duration);
+    return false;
 }
 
 
-inline bool
-Scheduler::Timers::reset(const Time_channel& chan, Duration duration)
+void
+Scheduler::resume(Task::Promise* taskp)
 {
-    bool        is_reset{false};
-    const Lock  lock{mutex};
-    const auto  alarmp{alarmq.find(chan)};
+    if (Task task = waiting.release(taskp)) {
+        const Task::Promise* runp = this_time_slice().taskp;
 
-    if (alarmp == alarmq.end())
-        start_alarm(chan, duration, &alarmq, handles.timer());
-    else {
-        reschedule(alarmp, duration, &alarmq, handles.timer());
-        if (!chan.try_receive())
-            is_reset = true;
+        // A task woken by the running task runs next, unless it's less urgent.
+        if (runp && taskp->priority() <= runp->priority())
+            ready.push_next(move(task));
+        else
+            ready.push(move(task));
     }
- 
-    return is_reset;
 }
 
 
 void
-Scheduler::Timers::run_thread()
+Scheduler::run_tasks(unsigned q)
 {
-    bool done{false};
-    Lock lock{mutex};
+    Time_slice& slice = this_time_slice();
 
-    while (!done) {
-        switch(handles.wait_any(&lock)) {
-        case timer_handle:
-            process_ready(&alarmq, handles.timer(), &lock);
-            break;
+    ready.attach(q);
+    this_worker_scheduler() = this;
+    this_frame_pool() = &pools[q];
+    this_node_pool() = &nodepools[ready.node(q)];
 
-        default:
-            done = true;
-            break;
-        }
-    }
-}
+    while (Task task = ready.pop(q)) {
+        Task::Promise& promise = task.handle().promise();
 
+        try {
+            slice.taskp = &promise;
+            slice.start = Clock::now();
+            slice.end   = slice.start + time_slice();
 
-void
-Scheduler::Timers::set_timer(Windows_handle timer, const Alarm& alarm, Time now)
-{
-    static const int nanosecs_per_tick = 100;
+            const Task::State state = task.resume();
 
-    const Duration      dt      = alarm.time - now;
-    const std::int64_t  timerdt = -(dt.count() / nanosecs_per_tick);
-    LARGE_INTEGER       timebuf;
+            // Charge the task before another worker can resume it.
+            promise.add_run_time(Clock::now() - slice.start);
+            slice.taskp = nullptr;
 
-    timebuf.LowPart = static_cast<DWORD>(timerdt & 0xFFFFFFFF);
-    timebuf.HighPart = static_cast<LONG>(timerdt >> 32);
-    SetWaitableTimer(timer, &timebuf, 0, NULL, NULL, FALSE);
+            switch(state) {
+            case Task::State::ready:
+                ready.yield(move(task));
+                break;
+
+            case Task::State::waiting:
+                waiting.insert(move(task));
+                break;
+            }
+        } catch (...) {
+            slice.taskp = nullptr;
+            ready.interrupt();
+        }
+
+        timers[q].process_ready();
+    }
+
+    this_frame_pool() = nullptr;
+    this_node_pool() = nullptr;
+    this_worker_scheduler() = nullptr;
 }
 
 
-inline void
-Scheduler::Timers::signal_alarm(Task::Promise* taskp, Time now, Lock* lockp)
+Alarm_id
+Scheduler::start_timer(Task::Promise* taskp, Duration duration)
 {
-    if (notify_timer_expired(taskp, now, lockp))
-        scheduler.resume(taskp);
+    return this_timers().start(taskp, duration);
 }
 
 
-inline void
-Scheduler::Timers::signal_alarm(const Time_channel& chan, Time now)
+Alarm_id
+Scheduler::start_timer(const Time_channel& chan, Duration duration)
 {
-    chan.try_send(now);
+    return this_timers().start(chan, duration);
 }
 
 
-void
-Scheduler::Timers::signal_ready(const Alarm& alarm, Time now, Lock* lockp)
+bool
+Scheduler::stop_timer(Alarm_id id)
 {
-    if (alarm.taskp)
-        signal_alarm(alarm.taskp, now, lockp);
-    else
-        signal_alarm(alarm.channel, now);
+    Timers* timersp = find_timers(id);
+    return timersp ? timersp->stop(id) : false;
 }
 
 
 void
-Scheduler::Timers::signal_ready(Alarm_queue* qp, Time now, Lock* lockp)
+Scheduler::seed_random(std::uint64_t seed)
 {
-    while (!qp->is_empty() && is_ready(qp->front(), now))
-        signal_ready(qp->pop(), now, lockp);
+    randseed.store(seed, memory_order_relaxed);
+    randepoch.fetch_add(1, memory_order_release);
 }
 
 
-inline void
-Scheduler::Timers::start(Task::Promise* taskp, Duration duration)
+int
+Scheduler::node_count() const
 {
-    sync_start(taskp, duration);
+    return static_cast<int>(nnodes);
 }
 
 
-inline void
-Scheduler::Timers::start(const Time_channel& chan, Duration duration)
+Scheduler::Priority_policy
+Scheduler::priority_policy() const
 {
-    sync_start(chan, duration);
+    return ready.policy();
 }
 
 
-template<class T>
-inline void
-Scheduler::Timers::start_alarm(const T& id, Duration duration, Alarm_queue* queuep, Windows_handle timer)
+void
+Scheduler::priority_policy(Priority_policy policy)
 {
-    const auto now      = Clock::now();
-    const auto expiry   = now + duration;
-    const auto alarmp   = queuep->push(Alarm{id, expiry});
-
-    if (alarmp == queuep->begin())
-        set_timer(timer, *alarmp, now);
+    ready.policy(policy);
 }
 
 
-inline bool
-Scheduler::Timers::stop(const Time_channel& chan)
+void
+Scheduler::time_slice(Duration dt)
 {
-    return sync_cancel(chan);
+    assert(dt >= 0ns);
+    slicens.store(dt.count(), memory_order_relaxed);
 }
 
 
-template<class T>
-inline bool
-Scheduler::Timers::sync_cancel(const T& id)
+Duration
+Scheduler::time_slice() const
 {
-    bool        is_cancel{false};
-    const Lock  lock{mutex};
-    const auto  alarmp{alarmq.find(id)};
-
-    if (alarmp != alarmq.end())
-        is_cancel = cancel(id, alarmp, &alarmq, handles.timer());
-
-    return is_cancel;
+    return Duration(slicens.load(memory_order_relaxed));
 }
 
 
-template<class T>
-inline void
-Scheduler::Timers::sync_start(const T& id, Duration duration)
+void
+Scheduler::submit(Task task, Task_priority prio)
 {
-    const Lock lock{mutex};
+    Task::Promise& promise = task.handle().promise();
 
-    start_alarm(id, duration, &alarmq, handles.timer());
+    promise.priority(prio);
+    promise.owner(this);
+    ready.push(move(task));
 }
 
 
 /*
-    Scheduler
+    The frame pool of the calling worker (null if not a worker).
 */
-Scheduler::Scheduler(int nthreads)
-    : ready{nthreads > 0 ? nthreads : Thread::hardware_concurrency()}
+inline Scheduler::Frame_pool*&
+Scheduler::this_frame_pool()
 {
-    const auto nqs = ready.size();
-
-    threads.reserve(nqs);
-    for (unsigned q = 0; q != nqs; ++q)
-        threads.emplace_back([&,q]{ run_tasks(q); });
+    static thread_local Frame_pool* poolp{nullptr};
+    return poolp;
 }
 
 
 /*
-    TODO:  Could this destructor should be rendered unnecessary by
-    arranging for (a) workqueues to shutdown implicitly (in their
-    destructors) and (b) workqueues to be joined implicitly (in their
-    destructors)?
+    The Scheduler of the calling worker (null if not a worker).
 */
-Scheduler::~Scheduler()
+inline Scheduler*&
+Scheduler::this_worker_scheduler()
 {
-    ready.interrupt();
-    for (auto& thread : threads)
-        thread.join();
+    static thread_local Scheduler* schedp{nullptr};
+    return schedp;
 }
 
 
-void
-Scheduler::cancel_timer(Task::Promise* taskp)
+Scheduler&
+Scheduler::this_scheduler()
 {
-    timers.cancel(taskp);
+    Scheduler* schedp = this_worker_scheduler();
+    return schedp ? *schedp : scheduler;
 }
 
 
-bool
-Scheduler::reset_timer(const Time_channel& chan, Duration duration)
+/*
+    The pool of the calling worker's NUMA node (null if not a worker).
+*/
+inline Scheduler::Node_pool*&
+Scheduler::this_node_pool()
 {
-    return timers.reset(chan, duration);
+    static thread_local Node_pool* poolp{nullptr};
+    return poolp;
 }
 
 
-void
-Scheduler::resume(Task::Promise* taskp)
+/*
+    The node pool from which the calling thread allocates frames, if it
+    has been directed to one.
+*/
+inline Scheduler::Node_pool*&
+Scheduler::this_node_hint()
 {
-    auto task = Task::Handle::from_promise(*taskp);
-    ready.push(waiting.release(task));
+    static thread_local Node_pool* poolp{nullptr};
+    return poolp;
 }
 
 
-void
-Scheduler::run_tasks(unsigned q)
+inline Scheduler::Random_engine&
+Scheduler::this_random_engine()
 {
-    while (Task task = ready.pop(q)) {
-        try {
-            switch(task.resume()) {
-            case Task::State::ready:
-                ready.push(q, move(task));
-                break;
-
-            case Task::State::waiting:
-                waiting.insert(move(task));
-                break;
-            }
-        } catch (...) {
-            ready.interrupt();
-        }
-    }
+    static thread_local Random_engine engine;
+    return engine;
 }
 
 
-void
-Scheduler::start_timer(Task::Promise* taskp, Duration duration)
+inline Scheduler::Time_slice&
+Scheduler::this_time_slice()
 {
-    timers.start(taskp, duration);
+    static thread_local Time_slice slice;
+    return slice;
 }
 
 
-void
-Scheduler::start_timer(const Time_channel& chan, Duration duration)
+bool
+Scheduler::is_slice_expired()
 {
-    timers.start(chan, duration);
+    const Time_slice& slice = this_time_slice();
+
+    return slice.taskp && Clock::now() >= slice.end;
 }
 
 
-bool
-Scheduler::stop_timer(const Time_channel& chan)
+/*
+    A worker arms its own timers.  Other threads spread their alarms
+    across the workers.
+*/
+Scheduler::Timers&
+Scheduler::this_timers()
 {
-    return timers.stop(chan);
+    auto q = ready.this_queue();
+
+    if (q == ready.size())
+        q = nextworker.fetch_add(1, memory_order_relaxed) % timers.size();
+
+    return timers[q];
 }
 
 
-void
-Scheduler::submit(Task task)
+/*
+    Time Slicing
+*/
+Duration
+this_task_run_time()
 {
-    ready.push(move(task));
+    const Scheduler::Time_slice& slice = Scheduler::this_time_slice();
+
+    if (!slice.taskp)
+        return 0ns;
+
+    return slice.taskp->run_time() + (Scheduler::Clock::now() - slice.start);
 }
 
 
@@ -1826,7 +3670,8 @@ Scheduler::submit(Task task)
     Timer
 */
 Timer::Timer(Duration duration)
-    : chan{is_valid(duration) ? make_timer(&scheduler, duration) : Time_channel()}
+    : schedp{&Scheduler::this_scheduler()}
+    , chan{is_valid(duration) ? make_timer(schedp, duration, &alarm) : Time_channel()}
 {
 }
 
@@ -1839,11 +3684,11 @@ Timer::is_valid(Duration x)
 
 
 inline Time_channel
-Timer::make_timer(Scheduler* schedp, Duration duration)
+Timer::make_timer(Scheduler* schedp, Duration duration, Alarm_id* idp)
 {
     Time_channel chan = make_channel<Time>(1);
 
-    scheduler.start_timer(chan, duration);
+    *idp = schedp->start_timer(chan, duration);
     return chan;
 }
 
@@ -1854,9 +3699,10 @@ Timer::reset(Duration duration)
     bool is_reset = false;
 
     if (is_valid(duration)) {
-        if (!chan)
-            chan = make_timer(&scheduler, duration);
-        else if (scheduler.reset_timer(chan, duration))
+        if (!chan) {
+            schedp = &Scheduler::this_scheduler();
+            chan = make_timer(schedp, duration, &alarm);
+        } else if (schedp->reset_timer(chan, &alarm, duration))
             is_reset = true;
     }
 
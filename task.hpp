@@ -20,6 +20,7 @@
 #define ISPTECH_COROUTINE_TASK_HPP
 
 #include "isptech/config.hpp"
+#include "boost/intrusive_ptr.hpp"
 #include "boost/operators.hpp"
 #include "boost/optional.hpp"
 #include <algorithm>
@@ -28,21 +29,25 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <deque>
 #include <exception>
 #include <experimental/coroutine>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <random>
 #include <thread>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
+#if defined _WIN32
 #include <windows.h>
+#endif
 
 
 /*
@@ -63,7 +68,15 @@ template<>              class Channel<void>;
 template<>              class Send_channel<void>;
 template<>              class Receive_channel<void>;
 template<typename T>    class Future;
+template<typename T>    class Future_state;
+template<typename T>    class All_futures_awaitable;
+template<typename T>    class Any_future_awaitable;
+class Future_state_base;
 class Channel_base;
+class Thread_parker;
+class Channel_waiter;
+class Channel_select_awaitable;
+class Select_set;
 class Channel_operation;
 using Channel_size = std::ptrdiff_t;
 class Scheduler;
@@ -71,9 +84,77 @@ using Time          = std::chrono::steady_clock::time_point;
 using Duration      = std::chrono::nanoseconds;
 using Time_channel  = Channel<Time>;
 class Timer;
+class Yield_awaitable;
 using boost::optional;
 using std::exception_ptr;
+#if defined _MSC_VER
 #pragma warning(disable: 4455)
+#endif
+
+
+/*
+    Alarm Identifier
+
+    Identifies an alarm scheduled by the Scheduler's timers so that it can
+    be canceled or rescheduled without a search.  An alarm is held by the
+    timers of the worker that armed it, in a slot of their queue.  The
+    serial number distinguishes an alarm from earlier ones that occupied
+    the same slot, so an identifier that outlives its alarm is harmless.
+*/
+class Alarm_id : boost::equality_comparable<Alarm_id> {
+public:
+    // Construct
+    Alarm_id() = default;
+    Alarm_id(std::uint32_t worker, std::uint32_t slot, std::uint32_t serial);
+
+    // Observers
+    std::uint32_t worker() const;
+    std::uint32_t slot() const;
+    std::uint32_t serial() const;
+
+    // Conversions
+    explicit operator bool() const;
+
+    // Comparisons
+    friend bool operator==(Alarm_id, Alarm_id);
+
+private:
+    // Data
+    std::uint32_t   workernum{0};
+    std::uint32_t   slotnum{0};
+    std::uint32_t   serialnum{0};   // zero is never issued
+};
+
+
+/*
+    Task Priority
+
+    The class of service of a task, which determines the lane in which the
+    Scheduler queues it whenever it's ready to run:  latency-critical tasks
+    (e.g., control messages and replies) run ahead of normal tasks, which
+    run ahead of background (bulk processing) tasks.
+*/
+enum class Task_priority : int { critical, normal, background };
+
+
+/*
+    NUMA Node Hint
+
+    Names the NUMA node whose memory should hold the frame of a new task.
+    A hint for a node that the Scheduler's workers don't occupy is ignored.
+*/
+class Node_hint {
+public:
+    // Construct
+    explicit Node_hint(int node);
+
+    // Observers
+    int node() const;
+
+private:
+    // Data
+    int nodenum;
+};
 
 
 /*
@@ -130,6 +211,9 @@ public:
     // Observers
     Handle handle() const;
 
+    // Modifiers
+    Handle release();
+
     // Execution
     State resume();
 
@@ -142,6 +226,7 @@ public:
     // Friends
     friend class Scheduler;
     friend class Channel_operation;
+    friend class Select_set;
     template<typename T> friend class Task_local;
 
 private:
@@ -164,20 +249,6 @@ private:
 
     class Operation_selector {
     public:
-        // Construct/Copy 
-        Operation_selector() = default;
-        Operation_selector(const Operation_selector&) = delete;
-        Operation_selector& operator=(const Operation_selector&) = delete;
-
-        // Selection
-        bool                    select(Task::Promise*, const Channel_operation*, const Channel_operation*);
-        Channel_size            selected() const;
-        optional<Channel_size>  try_select(const Channel_operation*, const Channel_operation*);
-
-        // Event Processing
-        Select_status notify_complete(Task::Promise*, Channel_size pos);
-
-    private:
         // Names/Types
         class Operation_view : boost::totally_ordered<Operation_view> {
         public:
@@ -187,8 +258,9 @@ private:
 
             // Execution
             bool is_ready() const;
-            void enqueue(Task::Promise*) const;
-            bool dequeue(Task::Promise*) const;
+            bool enqueue(Task::Promise*, Channel_waiter*) const;
+            bool dequeue(Channel_waiter*) const;
+            void dequeue_locked(Channel_waiter*) const;
             void execute() const;
 
             // Observers
@@ -205,22 +277,40 @@ private:
             Channel_size                index;
         };
 
-        using Operation_vector = std::vector<Operation_view>;
+        using Operation_vector  = std::vector<Operation_view>;
+        using Channel_vector    = std::vector<Channel_base*>;
 
+        // Construct/Copy 
+        Operation_selector() = default;
+        Operation_selector(const Operation_selector&) = delete;
+        Operation_selector& operator=(const Operation_selector&) = delete;
+
+        // Selection
+        bool                            select(Task::Promise*, const Channel_operation*, const Channel_operation*);
+        bool                            select(Task::Promise*, const Select_set&);
+        Channel_size                    selected() const;
+        optional<Channel_size>          try_select(const Channel_operation*, const Channel_operation*);
+        static optional<Channel_size>   try_select(const Select_set&);
+
+        // Operation Transformation (into channel lock order)
+        static void transform(const Channel_operation*, const Channel_operation*, Operation_vector* outp);
+        static void transform(const Operation_vector&, Channel_vector* outp);
+
+        // Event Processing
+        Select_status notify_complete(Channel_size pos);
+
+    private:
+        // Names/Types
         class Select_guard {
         public:
             // Construct/Copy/Destroy
             Select_guard(const Channel_operation*, const Channel_operation*, Operation_vector*);
+            explicit Select_guard(const Channel_vector& chans);   // distinct, in lock order
             Select_guard(const Select_guard&) = delete;
             Select_guard& operator=(const Select_guard&) = delete;
             ~Select_guard();
 
         private:
-            // Operation Transformation
-            static void transform_valid(const Channel_operation*, const Channel_operation*, Operation_vector* outp);
-            static void transform(const Channel_operation*, const Channel_operation*, Operation_vector* outp);
-            static void remove_duplicates(Operation_vector*);
-
             // Channel Synchronization
             static void                     lock_channels(const Operation_vector&);
             static void                     unlock_channels(const Operation_vector&);
@@ -229,19 +319,30 @@ private:
             static void                     unlock(Channel_base*);
 
             // Data
-            Operation_vector* pops;
+            const Operation_vector* pops{nullptr};
+            const Channel_vector*   pchans{nullptr};
         };
 
+        // Operation Transformation
+        static void transform_valid(const Channel_operation*, const Channel_operation*, Operation_vector* outp);
+        static void sort_operations(Operation_vector*);
+        static void order_pair(Operation_view*, Operation_view*);
+        static void remove_duplicates(Operation_vector*);
+
         // Selection
-        static optional<Channel_size>   select_ready(const Operation_vector&);
-        static Channel_size             count_ready(const Operation_vector&);
-        static Operation_view           pick_ready(const Operation_vector&, Channel_size nready);
-        static Channel_size             get_ready(const Operation_vector& ops, Channel_size n);
-        static Channel_size             enqueue(Task::Promise*, const Operation_vector&);
-        static Channel_size             dequeue(Task::Promise*, const Operation_vector&, Channel_size selected);
+        static optional<Channel_size>   select_ready(const Operation_vector&, Operation_vector* readyp);
+        static Operation_view           pick_ready(const Operation_vector& ready);
+        Channel_size                    enqueue(Task::Promise*, const Operation_vector&, Operation_vector* readyp);
+        Channel_size                    dequeue(const Operation_vector&, Channel_size selected);
+
+        // Names/Types
+        using Waiter_vector = std::vector<Channel_waiter>;
 
         // Data
         Operation_vector        operations;
+        Operation_vector        readyops;
+        Waiter_vector           waiters;    // one per operation enqueued
+        const Operation_vector* opsp{&operations};  // the operations being selected
         Channel_size            nenqueued;
         optional<Channel_size>  winner;
     };
@@ -262,17 +363,16 @@ private:
         // Event Processing
         bool notify_channel_readable(Task::Promise*, Channel_size chan);
         bool notify_timer_expired(Task::Promise*, Time);
-        bool notify_timer_canceled();
 
     private:
         // Names/Types
         class Wait_setup;
 
-        class Channel_wait {
+        class State_wait {
         public:
             // Construct
-            Channel_wait() = default;
-            Channel_wait(Channel_base*, Channel_size future);
+            State_wait() = default;
+            State_wait(Future_state_base*, Channel_size future);
     
             // Enqueue/Dequeue
             void enqueue(Task::Promise*, Channel_size pos) const;
@@ -284,65 +384,59 @@ private:
             bool is_ready() const;
 
             // Observers
-            Channel_base*   channel() const;
-            Channel_size    future() const;
+            Future_state_base*  state() const;
+            Channel_size        future() const;
 
         private:
             // Data
-            Channel_base*   chanp;
-            Channel_size    fpos;
-            mutable bool    is_enq{false};
+            Future_state_base*  statep;
+            Channel_size        fpos;
+            mutable bool        is_enq{false};
         };
 
-        using Channel_waits = std::vector<Channel_wait>;
+        using State_waits = std::vector<State_wait>;
 
         class Future_wait {
         public:
             // Construct
             Future_wait() = default;
-            Future_wait(bool* readyp, Channel_size vchan, Channel_size echan);
+            Future_wait(Future_state_base*, Channel_size wait);
 
             // Enqueue/Dequeue
-            void enqueue(Task::Promise*, const Channel_waits&) const;
-            bool dequeue(Task::Promise*, const Channel_waits&) const;
-            bool dequeue_unlocked(Task::Promise*, const Channel_waits&) const;
+            void enqueue(Task::Promise*, const State_waits&) const;
+            bool dequeue(Task::Promise*, const State_waits&) const;
+            bool dequeue_unlocked(Task::Promise*, const State_waits&) const;
 
             // Selection and Event Handling
-            bool complete(Task::Promise*, const Channel_waits&, Channel_size pos) const;
-            bool is_ready(const Channel_waits&) const;
+            bool complete(const State_waits&) const;
+            bool is_ready(const State_waits&) const;
 
             // Observers
-            Channel_size value() const;
-            Channel_size error() const;
+            Channel_size wait() const;
 
             // Comparisons
             bool operator==(const Future_wait&) const;
             bool operator< (const Future_wait&) const;
 
         private:
-            // Dequeue
-            static void dequeue_unlocked(Task::Promise*, const Channel_wait&, Channel_size pos);
-            static bool is_enqueued(const Channel_wait&, const Channel_wait&);
-
             // Data
-            bool*           signalp;
-            Channel_size    vpos;
-            Channel_size    epos;
+            Future_state_base*  statep;
+            Channel_size        pos;
         };
 
         // Names/Types
         using Future_waits      = std::vector<Future_wait>;
         using Future_wait_index = std::vector<Future_waits::size_type>;
 
-        class Channel_locks {
+        class State_locks {
         public:
             // Construct/Copy
-            Channel_locks() = default;
-            Channel_locks(const Channel_locks&) = delete;
-            Channel_locks& operator=(const Channel_locks&) = delete;
+            State_locks() = default;
+            State_locks(const State_locks&) = delete;
+            State_locks& operator=(const State_locks&) = delete;
 
             // Lock/Unlock
-            void acquire(const Future_wait_index&, const Future_waits&, const Channel_waits&);
+            void acquire(const Future_wait_index&, const Future_waits&, const State_waits&);
             void release();
 
             // Conversions
@@ -350,52 +444,52 @@ private:
 
         private:
             // Names/Types
-            using Channels = std::vector<Channel_base*>;
+            using States = std::vector<Future_state_base*>;
 
-            // Channel Processing
-            template<class F> static void   for_each_unique(const Channels&, F func);
-            static void                     transform(const Future_wait_index&, const Future_waits&, const Channel_waits&, Channels*);
-            static void                     sort(Channels*);
-            static void                     lock(const Channels&);
-            static void                     unlock(const Channels&);
-            static void                     lock_channel(Channel_base*);
-            static void                     unlock_channel(Channel_base*);
+            // State Processing
+            template<class F> static void   for_each_unique(const States&, F func);
+            static void                     transform(const Future_wait_index&, const Future_waits&, const State_waits&, States*);
+            static void                     sort(States*);
+            static void                     lock(const States&);
+            static void                     unlock(const States&);
+            static void                     lock_state(Future_state_base*);
+            static void                     unlock_state(Future_state_base*);
 
             // Data
-            Channels chans;
+            States states;
         };
 
         struct dequeue_from_locked {
             // Construct/Apply
-            dequeue_from_locked(Task::Promise*, const Future_waits&, const Channel_waits&);
+            dequeue_from_locked(Task::Promise*, const Future_waits&, const State_waits&);
             Channel_size operator()(Channel_size n, Channel_size i) const;
 
             // Data
             Task::Promise*          taskp;
             const Future_waits&     fwaits;
-            const Channel_waits&    cwaits;
+            const State_waits&      swaits;
         };
 
         struct dequeue_from_unlocked {
             // Construct/Apply
-            dequeue_from_unlocked(Task::Promise*, const Future_waits&, const Channel_waits&);
+            dequeue_from_unlocked(Task::Promise*, const Future_waits&, const State_waits&);
             Channel_size operator()(Channel_size n, Channel_size i) const;
 
             // Data
             Task::Promise*          taskp;
             const Future_waits&     fwaits;
-            const Channel_waits&    cwaits;
+            const State_waits&      swaits;
         };
 
         struct enqueue_not_ready {
             // Construct/Apply
-            enqueue_not_ready(Task::Promise*, const Future_waits&, const Channel_waits&);
+            enqueue_not_ready(Task::Promise*, const Future_waits&, const State_waits&);
             Channel_size operator()(Channel_size n, Channel_size i) const;
 
             // Data
             Task::Promise*          taskp;
             const Future_waits&     fwaits;
-            const Channel_waits&    cwaits;
+            const State_waits&      swaits;
         };
 
         class Wait_set {
@@ -422,8 +516,8 @@ private:
             Channel_size            notify_readable(Task::Promise*, Channel_size chan);
 
             // Synchronization
-            void lock_channels();
-            void unlock_channels();
+            void lock_states();
+            void unlock_states();
 
         private:
             // Assignment
@@ -431,23 +525,23 @@ private:
             static void                     index_unique(const Future_waits&, Future_wait_index*);
             static void                     remove_duplicates(Future_wait_index*, const Future_waits&);
             static void                     sort(Future_wait_index*, const Future_waits&);
-            template<class T> static void   transform(const Future<T>*, const Future<T>*, Future_waits*, Channel_waits*);
+            template<class T> static void   transform(const Future<T>*, const Future<T>*, Future_waits*, State_waits*);
 
             // Enqueue/Dequeue
-            static Channel_size dequeue_locked(Task::Promise*, const Future_wait_index&, const Future_waits&, const Channel_waits&);
-            static Channel_size dequeue_unlocked(Task::Promise*, const Future_wait_index&, const Future_waits&, const Channel_waits&);
+            static Channel_size dequeue_locked(Task::Promise*, const Future_wait_index&, const Future_waits&, const State_waits&);
+            static Channel_size dequeue_unlocked(Task::Promise*, const Future_wait_index&, const Future_waits&, const State_waits&);
 
             // Completion
-            static Channel_size             count_ready(const Future_wait_index&, const Future_waits&, const Channel_waits&);
-            static optional<Channel_size>   pick_ready(const Future_wait_index&, const Future_waits&, const Channel_waits&, Channel_size nready);
-            static Channel_size             get_ready(const Future_wait_index&, const Future_waits&, const Channel_waits&, Channel_size n);
+            static Channel_size             count_ready(const Future_wait_index&, const Future_waits&, const State_waits&);
+            static optional<Channel_size>   pick_ready(const Future_wait_index&, const Future_waits&, const State_waits&, Channel_size nready);
+            static Channel_size             get_ready(const Future_wait_index&, const Future_waits&, const State_waits&, Channel_size n);
 
             // Data
             Future_waits        futures;
-            Channel_waits       channels;
+            State_waits         states;
             Future_wait_index   index;
             Channel_size        nenqueued; // futures
-            Channel_locks       locks;
+            State_locks         locks;
         };
 
         class Wait_setup {
@@ -467,7 +561,7 @@ private:
         public:
             // Execution
             void start(Task::Promise*, Duration) const;
-            void cancel(Task::Promise*) const;
+            void cancel() const;
 
             // Observers
             bool is_running() const;    // clock is ticking
@@ -483,7 +577,9 @@ private:
             enum State : int { inactive, running, cancel_pending };
 
             // Data
-            mutable State state{inactive};
+            mutable State       state{inactive};
+            mutable Alarm_id    alarm;
+            mutable Scheduler*  schedp{nullptr};
         };
 
         // Selection
@@ -496,65 +592,112 @@ private:
         optional<Channel_size>  ready;
     };
 
+    /*
+        Local Key
+
+        Identifies the slot of a Task_local in each task.  The index of a
+        destroyed Task_local is reused, so a key also has a generation,
+        which keeps a Task_local from finding an object left in a task by
+        an earlier one with the same index.
+    */
+    struct Local_key {
+        std::size_t index;
+        std::size_t generation;
+    };
+
+    /*
+        Local Deleter
+
+        Destroys the objects of a Task_local.  The deleter is shared by the
+        Task_local and the slots holding its objects, so those objects can
+        outlive the Task_local.
+    */
+    class Local_deleter {
+    public:
+        // Destroy
+        virtual ~Local_deleter() = default;
+
+        // Destruction
+        virtual void operator()(void*) const = 0;
+    };
+
     // Names/Types
-    using Local_key     = void*;
-    using Local_deleter = std::function<void (void*)>;
+    using Local_deleter_ptr = std::shared_ptr<const Local_deleter>;
 
     class Local_impl {
     public:
-        // Construct/Copy/Move/Destroy
-        Local_impl(void* objectp, Local_deleter);
-        Local_impl(const Local_impl&) = default;
-        Local_impl& operator=(const Local_impl&) = default;
+        // Construct/Move/Destroy
+        Local_impl() = default;
         Local_impl(Local_impl&&);
         Local_impl& operator=(Local_impl&&);
         friend void swap(Local_impl&, Local_impl&);
+        Local_impl(const Local_impl&) = delete;
+        Local_impl& operator=(const Local_impl&) = delete;
         ~Local_impl();
 
         // Modifiers
-        void    reset(void* objectp);
-        void*   release();
+        void    reset(std::size_t generation, void* objectp, const Local_deleter_ptr&);
+        void*   release(std::size_t generation);
 
         // Observers
-        void* get() const;
+        void* get(std::size_t generation) const;
 
     private:
         // Data
-        void*           p;
-        Local_deleter   destroy;
+        void*               p{nullptr};
+        Local_deleter_ptr   deleterp;
+        std::size_t         owner{0};   // the generation of the Task_local
     };
 
     // Friends
     friend void swap(Local_impl&, Local_impl&);
 
-    class Local_impl_map {
+    /*
+        Local Slots
+
+        The task-local objects of a task, indexed by the keys assigned to
+        Task_locals as they're constructed.  The first few are stored in the
+        promise, and the rest in a vector that grows as needed (to the most
+        Task_locals alive at once).  Only the task itself accesses its
+        slots, so no locking is required.
+    */
+    class Local_slots {
     public:
-        // Construct/Copy/Move
-        Local_impl_map() = default;
-        Local_impl_map(const Local_impl_map&) = delete;
-        Local_impl_map& operator=(const Local_impl_map&) = delete;
+        // Construct/Copy
+        Local_slots() = default;
+        Local_slots(const Local_slots&) = delete;
+        Local_slots& operator=(const Local_slots&) = delete;
 
         // Modifiers
-        void  update(Local_key, Local_impl&&);
-        void  erase(Local_key);
-        void* release(Local_key);
+        void    reset(Local_key, void* objectp, const Local_deleter_ptr&);
+        void*   release(Local_key);
 
         // Observers
-        void* find(Local_key);
+        void* find(Local_key) const;
 
     private:
-        // Names/Types
-        using Value         = std::pair<Local_key, Local_impl>;
-        using Value_vector  = std::vector<Value>;
-
-        struct key_eq {
-            explicit key_eq(Local_key);
-            bool operator()(const Value&) const;
-            Local_key key;
-        };
+        // Constants
+        static const std::size_t ninline{8};
 
         // Data
-        Value_vector values;
+        Local_impl              inlines[ninline];
+        std::vector<Local_impl> overflow;
+    };
+
+    // Local Storage
+    static Local_key    make_local_key();
+    static void         free_local_key(Local_key);
+
+    /*
+        Waiting Link
+
+        Links a suspended task into the Scheduler's set of waiting tasks
+        without searching or allocating.
+    */
+    struct Waiting_link {
+        Promise*    prevp{nullptr};
+        Promise*    nextp{nullptr};
+        bool        is_linked{false};
     };
 
     // Random Number Generation
@@ -572,10 +715,12 @@ public:
         Promise(const Promise&) = delete;
         Promise& operator=(const Promise&) = delete;
 
-        // Channel Operation Selection
-        template<Channel_size N> void   select(const Channel_operation (&ops)[N]);
-        void                            select(const Channel_operation*, const Channel_operation*);
+        // Channel Operation Selection (true if an operation completed)
+        template<Channel_size N> bool   select(const Channel_operation (&ops)[N]);
+        bool                            select(const Channel_operation*, const Channel_operation*);
+        bool                            select(const Select_set&);
         static optional<Channel_size>   try_select(const Channel_operation*, const Channel_operation*);
+        static optional<Channel_size>   try_select(const Select_set&);
         Channel_size                    selected_operation() const;
 
         // Future Selection
@@ -594,11 +739,14 @@ public:
         Select_status   notify_operation_complete(Channel_size pos);
         bool            notify_channel_readable(Channel_size pos);
         bool            notify_timer_expired(Time);
-        bool            notify_timer_canceled();
 
         // Execution
-        void    make_ready();
-        State   state() const;
+        void            make_ready();
+        State           state() const;
+        Duration        run_time() const;
+        Task_priority   priority() const;
+        void            priority(Task_priority);
+        Scheduler*      owner() const;
 
         // Synchronization
         void unlock();
@@ -608,23 +756,34 @@ public:
         Initial_suspend initial_suspend() const;
         Final_suspend   final_suspend();
 
+        // Coroutine Frame Allocation
+        static void*    operator new(std::size_t);
+        static void     operator delete(void*, std::size_t);
+
         // Friends
         template<typename T> friend class Task_local;
+        friend class Scheduler;
 
     private:
         // Execution
         void suspend(Lock*);
+        void add_run_time(Duration);
+        void owner(Scheduler*);
 
         // Local Storage
-        void    update_local(Local_key, Local_impl&&);
-        void    erase_local(Local_key);
-        void*   find_local(Local_key);
+        void    reset_local(Local_key, void* objectp, const Local_deleter_ptr&);
+        void*   release_local(Local_key);
+        void*   find_local(Local_key) const;
 
         // Data
         Operation_selector  operations;
         Future_selector     futures;
-        Local_impl_map      locals;
+        Local_slots         locals;
         State               taskstate;
+        Duration            runtime;    // accumulated across resumptions
+        Task_priority       taskprio;
+        Scheduler*          schedp;     // the scheduler that runs the task
+        Waiting_link        waitlink;
         mutable Mutex       mutex;
     };
 
@@ -636,13 +795,33 @@ private:
 
 /*
     Task Launch
+
+    The launch policy of async() determines where its function runs.  An
+    eager function runs in a new task submitted to the Scheduler (this is
+    the default).  A deferred function runs when its future is first
+    awaited (or waited on by wait_any/wait_all), inline on the awaiting
+    task's worker, which spares a round trip through the scheduler queues
+    when the caller awaits the result right away; a deferred function
+    that is never awaited never runs.  An immediate function runs inline in
+    the caller before async() returns.
 */
+enum class Launch_policy { eager, deferred, immediate };
+
 template<class TaskFun, class... Args> void                                 start(TaskFun, Args&&...);
+template<class TaskFun, class... Args> void                                 start(Task_priority, TaskFun, Args&&...);
+template<class TaskFun, class... Args> void                                 start(Node_hint, TaskFun, Args&&...);
+template<class TaskFun, class... Args> void                                 start(Task_priority, Node_hint, TaskFun, Args&&...);
 template<class Fun, class... Args> Future<std::result_of_t<Fun(Args&&...)>> async(Fun, Args&&...);
+template<class Fun, class... Args> Future<std::result_of_t<Fun(Args&&...)>> async(Launch_policy, Fun, Args&&...);
 
 
 /*
     Task Local
+
+    An object of type T for each task that sets one, destroyed (by the
+    deleter) when the task is destroyed or the object is reset.  A task's
+    object can outlive its Task_local, in which case it's no longer
+    accessible but is still destroyed with the task.
 */
 template<typename T>
 class Task_local {
@@ -650,11 +829,12 @@ public:
     // Names/Types
     using Value = T;
 
-    // Construct/Copy
+    // Construct/Copy/Destroy
     Task_local();
     template<typename D> explicit Task_local(D deleter);
     Task_local(const Task_local&) = delete;
     Task_local& operator=(const Task_local&) = delete;
+    ~Task_local();
 
     // Modifiers
     void    reset(Task::Promise*, T* objectp);
@@ -665,23 +845,103 @@ public:
 
 private:
     // Names/Types
-    struct Default_deleter {
-        void operator()(void*) const;
-     };
+    struct Default_deleter : Task::Local_deleter {
+        void operator()(void*) const override;
+    };
 
     template<class D>
-    struct User_deleter {
+    struct User_deleter : Task::Local_deleter {
         explicit User_deleter(D&& impl);
-        void operator()(void*) const;
+        void operator()(void*) const override;
         D destroy;
     };
 
     // Deleter Construction
-    static Task::Local_deleter                      make_deleter();
-    template<class D> static Task::Local_deleter    make_deleter(D&& impl);
+    static const Task::Local_deleter_ptr& default_deleter();
+
+    // Data
+    Task::Local_key         key;
+    Task::Local_deleter_ptr deleterp;
+};
+
+
+/*
+    Thread Parker
+
+    Blocks an operating system thread (one that isn't running a task) until
+    another thread releases it.  A parked thread spins briefly in case the
+    release is imminent, and then sleeps on the parker's state word (a
+    futex on Linux, WaitOnAddress on Windows).  The spin limit adapts to
+    how often spinning has paid off on the calling thread.  A parker is
+    released at most once.
+*/
+class Thread_parker {
+public:
+    // Construct/Copy
+    Thread_parker() = default;
+    Thread_parker(const Thread_parker&) = delete;
+    Thread_parker& operator=(const Thread_parker&) = delete;
+
+    // Synchronization
+    void park();
+    void unpark();
+
+private:
+    // Names/Types
+    enum : std::uint32_t { empty, sleeping, released };
 
+    // Operating System Interface
+    void sleep();
+    void wake();
+
+    // Data
+    std::atomic<std::uint32_t> state{empty};
+};
+
+
+/*
+    Channel Waiter
+
+    A task or thread waiting to send to or receive from a channel.  Waiters
+    are linked directly into a channel's queues, so that they're queued and
+    unqueued in constant time without allocation.  The waiters of a task
+    are part of its selection state (one for each operation it's waiting
+    on); a thread's waiter lives on its stack with the parker that blocks
+    the thread.  The element buffers are
+    typed by the channel:  a sender supplies either an lvalue or an rvalue,
+    and a receiver supplies its buffer as an rvalue.
+*/
+class Channel_waiter {
+public:
+    // Construct
+    Channel_waiter() = default;
+    Channel_waiter(Thread_parker*, const void* lvaluep);
+    Channel_waiter(Thread_parker*, void* rvaluep);
+
+    // Assignment
+    void assign(Task::Promise*, Channel_size oper, const void* lvaluep, void* rvaluep);
+
+    // Observers
+    Task::Promise*  task() const;
+    Channel_size    operation() const;
+    Thread_parker*  parker() const;
+    const void*     lvalue() const;
+    void*           rvalue() const;
+    bool            is_queued() const;
+
+    // Friends
+    template<class T> friend class Channel;
+
+private:
     // Data
-    Task::Local_deleter deleter;
+    Task::Promise*  taskp{nullptr};
+    Channel_size    taskoper{-1};
+    Thread_parker*  threadp{nullptr};
+    const void*     lvbufp{nullptr};
+    void*           rvbufp{nullptr};
+    Channel_waiter* prevp{nullptr};
+    Channel_waiter* nextp{nullptr};
+    bool            isqueued{false};
 };
 
 
@@ -703,17 +963,21 @@ public:
     virtual bool is_readable() const = 0;
     virtual bool is_writable() const = 0;
 
+    // Lock-Free Send/Receive (false if the channel must be locked)
+    virtual bool fast_send(const void* lvaluep) = 0;
+    virtual bool fast_send(void* rvaluep) = 0;
+    virtual bool fast_receive(void* valuep) = 0;
+
     /*
         TODO:  Is there better name than "pos" for the enqueue/dequeue
         interfaces below (e.g., id, wait(er), read(er), or write(r))?
     */
 
-    // Blocking Send/Receive
-    virtual void enqueue_send(Task::Promise*, Channel_size oper, const void* lvaluep) = 0;
-    virtual void enqueue_send(Task::Promise*, Channel_size oper, void* rvaluep) = 0;
-    virtual bool dequeue_send(Task::Promise*, Channel_size oper) = 0;
-    virtual void enqueue_receive(Task::Promise*, Channel_size oper, void* valuep) = 0;
-    virtual bool dequeue_receive(Task::Promise*, Channel_size oper) = 0;
+    // Blocking Send/Receive (enqueue is true if the channel became ready)
+    virtual bool enqueue_send(Channel_waiter*) = 0;
+    virtual bool dequeue_send(Channel_waiter*) = 0;
+    virtual bool enqueue_receive(Channel_waiter*) = 0;
+    virtual bool dequeue_receive(Channel_waiter*) = 0;
 
     // Waiting
     virtual void enqueue_readable_wait(Task::Promise*, Channel_size wait) = 0;
@@ -757,8 +1021,10 @@ public:
     // Execution
     bool is_ready() const;
     void execute() const;
-    void enqueue(Task::Promise*, Channel_size pos) const;
-    bool dequeue(Task::Promise*, Channel_size pos) const;
+    bool try_execute() const;   // without locking the channel
+    bool enqueue(Task::Promise*, Channel_size pos, Channel_waiter*) const;
+    bool dequeue(Channel_waiter*) const;
+    bool dequeue_locked(Channel_waiter*) const; // with the channel locked
 
     // Observers
     Channel_base* channel() const;
@@ -779,6 +1045,55 @@ private:
 };
 
 
+/*
+    Channel Operation Select Set
+
+    A set of channel operations prepared for repeated selection, as by a
+    task that selects from the same channels in a loop.  When operations
+    are assigned to the set, it computes the order in which their channels
+    are locked and allocates the buffers used during selection, so that
+    selecting from the set, which can be repeated any number of times,
+    does neither.  Selecting from a set yields the position of an operation
+    in the sequence from which the set was assigned.  A set can be
+    selected by one task at a time and must outlive the selection.
+*/
+class Select_set {
+public:
+    // Construct/Copy/Move
+    Select_set() = default;
+    Select_set(const Channel_operation*, const Channel_operation*);
+    template<Channel_size N> explicit Select_set(const Channel_operation (&ops)[N]);
+    Select_set(const Select_set&) = delete;
+    Select_set& operator=(const Select_set&) = delete;
+    Select_set(Select_set&&) = default;
+    Select_set& operator=(Select_set&&) = default;
+
+    // Assignment
+    void                            assign(const Channel_operation*, const Channel_operation*);
+    template<Channel_size N> void   assign(const Channel_operation (&ops)[N]);
+
+    // Size
+    Channel_size size() const;
+
+    // Selection
+    Channel_select_awaitable operator co_await() const;
+
+    // Friends
+    friend class Task;
+
+private:
+    // Names/Types
+    using Operation_vector  = Task::Operation_selector::Operation_vector;
+    using Channel_vector    = Task::Operation_selector::Channel_vector;
+
+    // Data
+    std::vector<Channel_operation>  ops;
+    Operation_vector                prepared;   // in channel lock order
+    Channel_vector                  channels;   // distinct, in lock order
+    mutable Operation_vector        readyops;   // selection scratch
+};
+
+
 /*
     Channel Operation Selection Awaitable
 */
@@ -786,6 +1101,7 @@ class Channel_select_awaitable {
 public:
     // Construct
     Channel_select_awaitable(const Channel_operation*, const Channel_operation*);
+    explicit Channel_select_awaitable(const Select_set*);
 
     // Awaitable Operations
     bool            await_ready();
@@ -795,8 +1111,9 @@ public:
 private:
     // Data
     Task::Promise*              promisep;
-    const Channel_operation*    first;
-    const Channel_operation*    last;
+    const Channel_operation*    first{nullptr};
+    const Channel_operation*    last{nullptr};
+    const Select_set*           setp{nullptr};
 };
 
 
@@ -805,14 +1122,25 @@ private:
 */
 template<Channel_size N> Channel_select_awaitable   select(const Channel_operation (&ops)[N]);
 Channel_select_awaitable                            select(const Channel_operation*, const Channel_operation*);
+Channel_select_awaitable                            select(const Select_set&);
 template<Channel_size N> optional<Channel_size>     try_select(const Channel_operation (&ops)[N]);
 optional<Channel_size>                              try_select(const Channel_operation*, const Channel_operation*);
+optional<Channel_size>                              try_select(const Select_set&);
 
 
 /*
     Channel Construction
+
+    A buffered channel can be specialized for a single consumer and either
+    a single producer (spsc) or multiple producers (mpsc).  Elements then
+    pass through a lock-free ring, and the channel is only locked to park
+    or wake waiting tasks and threads, or to select among operations.  The
+    caller is responsible for honoring the restriction.  Unbuffered
+    channels are always mpmc.
 */
-template<class T> Channel<T> make_channel(Channel_size capacity=0);
+enum class Channel_flavor : int { mpmc, spsc, mpsc };
+
+template<class T> Channel<T> make_channel(Channel_size capacity=0, Channel_flavor=Channel_flavor::mpmc);
 
 
 /*
@@ -824,6 +1152,8 @@ public:
     // Names/Types
     class Send_awaitable;
     class Receive_awaitable;
+    class Send_n_awaitable;
+    class Receive_n_awaitable;
     using Value = T;
 
     // Construct/Copy
@@ -832,7 +1162,7 @@ public:
     Channel& operator=(const Channel&) = default;
     Channel(Channel&&);
     Channel& operator=(Channel&&);
-    template <class T> friend Channel<T> make_channel<T>(Channel_size capacity);
+    template <class T> friend Channel<T> make_channel<T>(Channel_size capacity, Channel_flavor);
     inline friend void swap(Channel& x, Channel& y) { swap(x.pimpl, y.pimpl); }
 
     // Size and Capacity
@@ -856,6 +1186,21 @@ public:
     inline friend void  blocking_send(const Channel& c, T&& x)      { c.pimpl->blocking_send(&x); }
     inline friend T     blocking_receive(const Channel& c)          { return c.pimpl->blocking_receive(); }
 
+    /*
+        Batched Send/Receive
+
+        Each operation transfers at least one element (waiting if necessary,
+        except for the try_ forms) and at most n, with a single acquisition
+        of the channel lock, and returns the number transferred.  Elements
+        are copied from [first, first+n) or moved into [first, first+n).
+    */
+    Send_n_awaitable                send_n(const T* first, Channel_size n) const;
+    Receive_n_awaitable             receive_n(T* first, Channel_size n) const;
+    Channel_size                    try_send_n(const T* first, Channel_size n) const;
+    Channel_size                    try_receive_n(T* first, Channel_size n) const;
+    inline friend Channel_size      blocking_send_n(const Channel& c, const T* first, Channel_size n)   { return c.pimpl->blocking_send_n(first, n); }
+    inline friend Channel_size      blocking_receive_n(const Channel& c, T* first, Channel_size n)     { return c.pimpl->blocking_receive_n(first, n); }
+
     // Conversions
     explicit operator bool() const;
 
@@ -874,7 +1219,9 @@ private:
     // Names/Types
     using Mutex     = std::mutex;
     using Lock      = std::unique_lock<Mutex>;
-    using Condition = std::condition_variable;
+
+    // Constants
+    static const std::size_t cache_line_size{64};
 
     class Readable_waiter : boost::equality_comparable<Readable_waiter> {
     public:
@@ -905,10 +1252,20 @@ private:
         Channel_size    chanpos;
     };
 
+    /*
+        Buffer
+
+        The elements of a mutex-protected channel, stored in a ring that is
+        allocated once (aligned to a cache line) for the channel's capacity,
+        so sending and receiving never allocate.
+    */
     class Buffer {
     public:
-        // Construct
+        // Construct/Destroy
         explicit Buffer(Channel_size maxsize);
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        ~Buffer();
 
         // Size and Capacity
         Channel_size    size() const;
@@ -926,37 +1283,89 @@ private:
         bool dequeue(const Readable_waiter&);
 
     private:
+        // Names/Types
+        using Storage = std::unique_ptr<char[]>;
+
+        // Storage
+        static Storage  allocate(Channel_size n, T** elemspp);
+        T*              element(Channel_size i) const;
+
         // Data
-        std::queue<T>               elemq;
+        T*                          elems{nullptr};
+        Storage                     storage;
         Channel_size                sizemax;
+        Channel_size                head{0};
+        Channel_size                count{0};
         std::deque<Readable_waiter> readers;
     };
 
-    class Send : boost::equality_comparable<Send> {
+    /*
+        Ring
+
+        A bounded lock-free queue for channels with a single consumer.
+        Producers claim a cell by advancing the tail, then publish the
+        element through the cell's sequence number (after Vyukov), so
+        several can push concurrently if the ring is shared.  Only the
+        consumer pops, or another thread holding the channel lock while the
+        consumer waits.  Readable waiters are guarded by the channel lock,
+        as in the Buffer.
+    */
+    class Ring {
     public:
         // Construct
-        Send(Task::Promise*, Channel_size oper, const T* lvaluep);
-        Send(Task::Promise*, Channel_size oper, T* rvaluep);
-        Send(Condition*, const T* lvaluep);
-        Send(Condition*, T* rvaluep);
-    
-        // Observers
-        Task::Promise*  task() const;
-        Channel_size    operation() const;
+        Ring(Channel_size maxsize, bool is_shared);
+
+        // Size and Capacity
+        Channel_size    size() const;
+        Channel_size    capacity() const;
+        bool            is_empty() const;
+        bool            is_full() const;
+
+        // Queue Operations
+        template<class U> bool push(U&&, Mutex*);
+        template<class U> bool push_silent(U&&);
+        template<class U> bool pop(U*);
+        T*                     front();
+        void                   pop_front();
+
+        // Waiters
+        void enqueue(const Readable_waiter&);
+        bool dequeue(const Readable_waiter&);
+        void notify(Mutex*);
+        bool is_waited() const;
+
+    private:
+        // Names/Types
+        using Index = std::size_t;
+
+        struct Cell {
+            std::atomic<Index>  seq;
+            T                   value;
+        };
+
+        // Cell Sequencing
+        static Index free_seq(Index pos);
+        static Index full_seq(Index pos);
+
+        // Data
+        std::unique_ptr<Cell[]>     cells;
+        Index                       sizemax;
+        bool                        is_multiproducer;
+        std::atomic<Index>          head{0};
+        char                        headpad[cache_line_size - sizeof(std::atomic<Index>)];
+        std::atomic<Index>          tail{0};
+        char                        tailpad[cache_line_size - sizeof(std::atomic<Index>)];
+        std::deque<Readable_waiter> readers;
+    };
+
+    class Send {
+    public:
+        // Construct
+        explicit Send(const Channel_waiter&);
 
         // Completion
         template<class U> bool dequeue(U* recvbufp, Mutex*) const;
 
-        // Comparisons
-        inline friend bool operator==(const Send& x, const Send& y) {
-            if (x.lvbufp != y.lvbufp) return false;
-            if (x.rvbufp != y.rvbufp) return false;
-            if (x.taskp != y.taskp) return false;
-            if (x.taskoper != y.taskoper) return false;
-            if (x.threadcondp != y.threadcondp) return false;
-            return true;
-        }
-    
     private:
         // Data Transefer
         template<class U> static void   move(const T* lvsendbufp, T* rvsendbufp, U* recvbufp);
@@ -965,76 +1374,51 @@ private:
         // Data
         Task::Promise*  taskp;
         Channel_size    taskoper;
-        Condition*      threadcondp;
+        Thread_parker*  threadp;
         const T*        lvbufp; // lvalue
         T*              rvbufp; // rvalue
     };
     
-    class Receive : boost::equality_comparable<Receive> {
+    class Receive {
     public:
         // Construct
-        Receive(Task::Promise*, Channel_size pos, T* valuep);
-        Receive(Condition*, T* valuep);
+        explicit Receive(const Channel_waiter&);
 
-        // Observers
-        Task::Promise*  task() const;
-        Channel_size    operation() const;
-    
         // Selection
         template<class U> bool dequeue(U* sendbufp, Mutex*) const;
     
-        // Comparisons
-        inline friend bool operator==(const Receive& x, const Receive& y) {
-            if (x.bufp != y.bufp) return false;
-            if (x.taskp != y.taskp) return false;
-            if (x.taskoper != y.taskoper) return false;
-            if (x.threadcondp != y.threadcondp) return false;
-            return true;
-        }
-    
     private:
         // Data
         Task::Promise*  taskp;
         Channel_size    taskoper;
-        Condition*      threadcondp;
+        Thread_parker*  threadp;
         T*              bufp;
     };
 
+    /*
+        I/O Queue
+
+        An intrusive FIFO of waiters, each of which is popped as a Send or
+        Receive (copied out of the waiter, which its owner can then reuse).
+    */
     template<class U> 
     class Io_queue {
-    private:
-        // Names/Types
-        using Waiter_deque = std::deque<U>;
-
-        struct waiter_eq {
-            waiter_eq(Task::Promise* tp, Channel_size pos) : taskp{tp}, oper{pos} {}
-            bool operator()(const U& waiting) const {
-                return waiting.task() == taskp && waiting.operation() == oper;
-            }
-            Task::Promise*  taskp;
-            Channel_size    oper;
-        };
-
-        // Data
-        Waiter_deque waiters;
-
     public:
         // Names/Types
-        using Waiter    = U;
-        using Iterator  = typename Waiter_deque::iterator;
-
-        // Iterators
-        Iterator end();
+        using Waiter = U;
 
         // Size and Capacity
         bool is_empty() const;
 
         // Queue Operations
-        void        push(const Waiter&);
-        Waiter      pop();
-        void        erase(Iterator);
-        Iterator    find(Task::Promise*, Channel_size pos);
-        bool        is_found(const Waiter&) const;
+        void    push(Channel_waiter*);
+        Waiter  pop();
+        bool    erase(Channel_waiter*);     // false if not queued
+
+    private:
+        // Data
+        Channel_waiter* headp{nullptr};
+        Channel_waiter* tailp{nullptr};
     };
 
     /*
@@ -1058,10 +1442,25 @@ private:
     using Send_queue    = Io_queue<Send>;
     using Receive_queue = Io_queue<Receive>;
 
+    /*
+        Channel Implementation
+
+        Shared by its handles through an intrusive reference count, and
+        allocated from the Scheduler's pools, so a short-lived channel
+        (e.g., behind a Future) costs a single pooled block.
+    */
     class Impl : public Channel_base {
     public:
         // Construct
-        explicit Impl(Channel_size bufsize);
+        Impl(Channel_size bufsize, Channel_flavor);
+
+        // Allocation
+        static void*    operator new(std::size_t);
+        static void     operator delete(void*, std::size_t);
+
+        // Reference Counting
+        inline friend void intrusive_ptr_add_ref(Impl* p) { p->nrefs.fetch_add(1, std::memory_order_relaxed); }
+        inline friend void intrusive_ptr_release(Impl* p) { if (p->nrefs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete p; }
 
         // Size and Capacity
         Channel_size    size() const;
@@ -1077,6 +1476,14 @@ private:
         template<class U> void              blocking_send(U* valuep);
         T                                   blocking_receive();
 
+        // Batched Send/Receive
+        Send_n_awaitable    awaitable_send_n(const T* first, Channel_size n);
+        Receive_n_awaitable awaitable_receive_n(T* first, Channel_size n);
+        Channel_size        try_send_n(const T* first, Channel_size n);
+        Channel_size        try_receive_n(T* first, Channel_size n);
+        Channel_size        blocking_send_n(const T* first, Channel_size n);
+        Channel_size        blocking_receive_n(T* first, Channel_size n);
+
         // Operation Construction
         Channel_operation make_send(const T* valuep);
         Channel_operation make_send(T* valuep);
@@ -1089,12 +1496,16 @@ private:
         bool is_readable() const override;
         bool is_writable() const override;
 
+        // Lock-Free I/O
+        bool fast_send(const void* lvaluep) override;
+        bool fast_send(void* rvaluep) override;
+        bool fast_receive(void* valuep) override;
+
         // Blocking I/O
-        void enqueue_receive(Task::Promise*, Channel_size oper, void* valuep) override;
-        bool dequeue_receive(Task::Promise*, Channel_size oper) override;
-        void enqueue_send(Task::Promise*, Channel_size oper, const void* rvaluep) override;
-        void enqueue_send(Task::Promise*, Channel_size oper, void* lvaluep) override;
-        bool dequeue_send(Task::Promise*, Channel_size oper) override;
+        bool enqueue_receive(Channel_waiter*) override;
+        bool dequeue_receive(Channel_waiter*) override;
+        bool enqueue_send(Channel_waiter*) override;
+        bool dequeue_send(Channel_waiter*) override;
 
         // Event Waiting
         void enqueue_readable_wait(Task::Promise*, Channel_size wait) override;
@@ -1105,27 +1516,53 @@ private:
         void unlock() override;
 
     private:
+        // Names/Types
+        enum class Io_status : int { complete, blocked, contended };
+
         // Non-Blocking I/O
-        template<class U> bool send(U* valuep, Buffer*, Receive_queue*, Mutex*);
-        template<class U> bool receive(U* valuep, Buffer*, Send_queue*, Mutex*);
+        template<class U, class B> bool         send(U* valuep, B* bufp, Receive_queue*, Mutex*);
+        template<class U, class B> bool         receive(U* valuep, B* bufp, Send_queue*, Mutex*);
+        template<class U, class B> Channel_size send_n(U* first, Channel_size n, B* bufp, Receive_queue*, Mutex*);
+        template<class U, class B> Channel_size receive_n(U* first, Channel_size n, B* bufp, Send_queue*, Mutex*);
+
+        // Lock-Free I/O
+        bool                        is_lockfree() const;
+        template<class U> Io_status try_push(U* valuep);
+        template<class U> Io_status try_pop(U* valuep);
+        template<class U> bool      lockfree_send(U* valuep);
+        template<class U> bool      lockfree_receive(U* valuep);
+        template<class U> void      lockfree_blocking_send(U* valuep);
+        void                        lockfree_blocking_receive(T* valuep);
+        Channel_size                lockfree_send_n(const T* first, Channel_size n);
+        Channel_size                lockfree_receive_n(T* first, Channel_size n);
+        void                        wake_readers();
+        void                        release_readers();
+        bool                        enter_fast();
+        void                        leave_fast();
+        static void                 announce(std::atomic<bool>*);
 
         // Blocking I/O
-        void                            enqueue_receive(Task::Promise*, Channel_size oper, T* valuep);
-        template<class U> void          enqueue_send(Task::Promise*, Channel_size oper, U* valuep);
+        void                            blocking_receive(T* valuep);
         template<class U> static bool   dequeue(Receive_queue*, U* sendbufp, Mutex*);
         template<class U> static bool   dequeue(Send_queue*, U* recvbufp, Mutex*);
-        template<class U> static bool   dequeue(U* waitqp, Task::Promise*, Channel_size pos);
         static void                     wait_for_sender(Receive_queue*, T* recvbufp, Lock*);
         template<class U> static void   wait_for_receiver(Send_queue*, U* sendbufp, Lock*);
 
         // Data
-        Buffer          buffer;
-        Send_queue      sendq;
-        Receive_queue   receiveq;
-        mutable Mutex   mutex;
+        Channel_flavor              flavor;
+        Buffer                      buffer;
+        Ring                        ring;
+        Send_queue                  sendq;
+        Receive_queue               receiveq;
+        mutable std::atomic<bool>   is_reader_waiting{false};
+        mutable std::atomic<bool>   is_writer_waiting{false};
+        std::atomic<int>            nfast{0};
+        std::atomic<int>            ngates{0};
+        std::atomic<int>            nrefs{0};
+        mutable Mutex               mutex;
     };
 
-    using Impl_ptr = std::shared_ptr<Impl>;
+    using Impl_ptr = boost::intrusive_ptr<Impl>;
 
     // Construct
     Channel(Impl_ptr);
@@ -1186,36 +1623,95 @@ private:
 
 
 /*
-    Send Channel
+    Channel Batched Send Awaitable
 */
 template<class T>
-class Send_channel : boost::totally_ordered<Send_channel<T>> {
+class Channel<T>::Send_n_awaitable {
 public:
-    // Names/Types
-    using Value     = typename Channel<T>::Value;
-    using Awaitable = typename Channel<T>::Send_awaitable;
+    // Awaitable Operations
+    bool            await_ready();
+    bool            await_suspend(Task::Handle);
+    Channel_size    await_resume();
 
-    // Construct/Copy
-    Send_channel() = default;
-    Send_channel& operator=(Send_channel);
-    inline friend void swap(Send_channel& x, Send_channel& y) { swap(x.pimpl, y.pimpl); }
+private:
+    // Friends
+    friend class Impl;
 
-    // Size and Capacity
-    Channel_size    size() const;
-    Channel_size    capacity() const;
-    bool            is_empty() const;
-    bool            is_full() const;
+    // Construct
+    Send_n_awaitable(Impl*, const T* first, Channel_size n);
 
-    // Non-Blocking Channel Operations
+    // Data
+    Impl*               chanp;
+    const T*            elemsp;
+    Channel_size        nelems;
+    Channel_size        nsent{0};
+    Channel_operation   send[1];
+};
+
+
+/*
+    Channel Batched Receive Awaitable
+*/
+template<class T>
+class Channel<T>::Receive_n_awaitable {
+public:
+    // Awaitable Operations
+    bool            await_ready();
+    bool            await_suspend(Task::Handle);
+    Channel_size    await_resume();
+
+private:
+    // Friends
+    friend class Impl;
+
+    // Construct
+    Receive_n_awaitable(Impl*, T* first, Channel_size n);
+
+    // Data
+    Impl*               chanp;
+    T*                  elemsp;
+    Channel_size        nelems;
+    Channel_size        nreceived{0};
+    Channel_operation   receive[1];
+};
+
+
+/*
+    Send Channel
+*/
+template<class T>
+class Send_channel : boost::totally_ordered<Send_channel<T>> {
+public:
+    // Names/Types
+    using Value     = typename Channel<T>::Value;
+    using Awaitable = typename Channel<T>::Send_awaitable;
+
+    // Construct/Copy
+    Send_channel() = default;
+    Send_channel& operator=(Send_channel);
+    inline friend void swap(Send_channel& x, Send_channel& y) { swap(x.pimpl, y.pimpl); }
+
+    // Size and Capacity
+    Channel_size    size() const;
+    Channel_size    capacity() const;
+    bool            is_empty() const;
+    bool            is_full() const;
+
+    // Non-Blocking Channel Operations
     Awaitable           send(const T&) const;
     Awaitable           send(T&&) const;
     bool                try_send(const T&) const;
     Channel_operation   make_send(const T&) const;
     Channel_operation   make_send(T&&) const;
 
+    // Batched Channel Operations (see Channel)
+    typename Channel<T>::Send_n_awaitable   send_n(const T* first, Channel_size n) const;
+    Channel_size                            try_send_n(const T* first, Channel_size n) const;
+
     // Blocking Channel Operations (move out of body if >= VS '17)
     inline friend void blocking_send(const Send_channel& c, const T& x) { c.pimpl->blocking_send(&x); }
     inline friend void blocking_send(const Send_channel& c, T&& x)      { c.pimpl->blocking_send(&x); }
+    inline friend Channel_size blocking_send_n(const Send_channel& c, const T* first, Channel_size n) { return c.pimpl->blocking_send_n(first, n); }
 
     // Conversions
     Send_channel(Channel<T>);
@@ -1258,8 +1754,13 @@ public:
     optional<T>         try_receive() const;
     Channel_operation   make_receive(T*) const;
 
+    // Batched Channel Operations (see Channel)
+    typename Channel<T>::Receive_n_awaitable    receive_n(T* first, Channel_size n) const;
+    Channel_size                                try_receive_n(T* first, Channel_size n) const;
+
     // Blocking Channel Operations (move out of body if >= VS '17)
     inline friend T blocking_receive(const Receive_channel& c) { return c.pimpl->blocking_receive(); }
+    inline friend Channel_size blocking_receive_n(const Receive_channel& c, T* first, Channel_size n) { return c.pimpl->blocking_receive_n(first, n); }
 
     // Conversions
     Receive_channel(Channel<T>);
@@ -1270,9 +1771,6 @@ public:
     inline friend bool operator==(const Receive_channel& x, const Receive_channel& y) { return x.pimpl == y.pimpl; }
     inline friend bool operator< (const Receive_channel& x, const Receive_channel& y) { return x.pimpl < y.pimpl; }
 
-    // Friends
-    template <class T> friend class Future;
-
 private:
     // Data
     typename Channel<T>::Impl_ptr pimpl;
@@ -1298,7 +1796,7 @@ public:
     Channel(Channel&&);
     Channel& operator=(Channel&&);
     friend void swap(Channel&, Channel&);
-    template <class T> friend Channel<T> make_channel<T>(Channel_size capacity);
+    template <class T> friend Channel<T> make_channel<T>(Channel_size capacity, Channel_flavor);
 
     // Size and Capacity
     Channel_size    size() const;
@@ -1334,7 +1832,7 @@ private:
     class Impl : public Channel<char>::Impl {
     public:
         // Construct
-        explicit Impl(Channel_size bufsize);
+        Impl(Channel_size bufsize, Channel_flavor);
 
         // Non-Blocking Send/Receive
         Awaitable           send();
@@ -1353,7 +1851,7 @@ private:
         char scratch;
     };
 
-    using Impl_ptr = std::shared_ptr<Impl>;
+    using Impl_ptr = boost::intrusive_ptr<Impl>;
 
     // Construct
     Channel(Impl_ptr);
@@ -1467,15 +1965,131 @@ public:
     friend bool operator==(const Receive_channel&, const Receive_channel&);
     friend bool operator< (const Receive_channel&, const Receive_channel&);
 
-    // Friends
-    friend class Future<void>;
-
 private:
     // Data
     Channel<void>::Impl_ptr pimpl;
 };
 
 
+/*
+    Future State
+
+    The one-shot result shared by a Future and the task that produces it:
+    a value or an exception, published once.  At most one task at a time
+    can wait for the result (e.g., by awaiting the Future or selecting it
+    in wait_any/wait_all), so the state holds a single waiter.  The state is
+    reference counted intrusively and allocated from the Scheduler's pools.
+*/
+class Future_state_base {
+public:
+    // Construct/Copy/Destroy
+    Future_state_base() = default;
+    Future_state_base(const Future_state_base&) = delete;
+    Future_state_base& operator=(const Future_state_base&) = delete;
+    virtual ~Future_state_base() = default;
+
+    // Allocation
+    static void*    operator new(std::size_t);
+    static void     operator delete(void*, std::size_t);
+
+    // Observers
+    bool is_ready() const;
+
+    // Deferred Execution
+    virtual bool run_deferred();
+
+    // Waiting (the state must be locked)
+    void enqueue_readable_wait(Task::Promise*, Channel_size wait);
+    bool dequeue_readable_wait(Task::Promise*, Channel_size wait);
+
+    // Synchronization
+    void lock();
+    void unlock();
+
+    // Reference Counting
+    inline friend void intrusive_ptr_add_ref(Future_state_base* p) { p->nrefs.fetch_add(1, std::memory_order_relaxed); }
+    inline friend void intrusive_ptr_release(Future_state_base* p) { if (p->nrefs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete p; }
+
+protected:
+    // Publication
+    void publish();
+
+private:
+    // Names/Types
+    using Mutex = std::mutex;
+    using Lock  = std::unique_lock<Mutex>;
+
+    // Data
+    std::atomic<bool>   isready{false};
+    Task::Promise*      waiterp{nullptr};
+    Channel_size        waitpos{0};
+    std::atomic<int>    nrefs{0};
+    Mutex               mutex;
+};
+
+
+template<class T>
+class Future_state : public Future_state_base {
+public:
+    // Publication
+    template<class U> void                      set_value(U&&);
+    void                                        set_exception(exception_ptr);
+    template<class Fun, class... Args> void     set_result(Fun&, Args&&...);
+
+    // Result Access (once ready)
+    T get();
+
+private:
+    // Data
+    optional<T>     value;
+    exception_ptr   error;
+};
+
+
+template<>
+class Future_state<void> : public Future_state_base {
+public:
+    // Publication
+    void                                    set_value();
+    void                                    set_exception(exception_ptr);
+    template<class Fun, class... Args> void set_result(Fun&, Args&&...);
+
+    // Result Access (once ready)
+    void get();
+
+private:
+    // Data
+    exception_ptr error;
+};
+
+
+/*
+    Deferred Future State
+
+    The state of a future whose function is deferred until a task awaits
+    the result.  The function and copies of its arguments are stored with
+    the state, and the first task to claim the function runs it.
+*/
+template<class T, class Fun, class... Args>
+class Deferred_future_state : public Future_state<T> {
+public:
+    // Construct
+    template<class F, class... As> explicit Deferred_future_state(F&&, As&&...);
+
+    // Deferred Execution
+    bool run_deferred() override;
+
+private:
+    // Execution
+    template<std::size_t... Is> void run(std::index_sequence<Is...>);
+
+    // Data
+    Fun                 fun;
+    std::tuple<Args...> args;
+    std::atomic<bool>   isclaimed{false};
+};
+
+
 /*
     Future
 
@@ -1486,23 +2100,18 @@ class Future : boost::equality_comparable<Future<T>> {
 public:
     // Names/Types
     class Awaitable;
-    using Value             = T;
-    using Value_receiver    = Receive_channel<T>;
-    using Error_receiver    = Receive_channel<exception_ptr>;
+    using Value     = T;
+    using State     = Future_state<T>;
+    using State_ptr = boost::intrusive_ptr<State>;
 
     // Construct/Copy
-    Future();
-    Future(Value_receiver, Error_receiver);
+    Future() = default;
+    explicit Future(State_ptr);
     Future(const Future&) = delete;
     Future& operator=(const Future&) = delete;
     Future(Future&&);
     Future& operator=(Future&&);
-    inline friend void swap(Future& x, Future& y) {
-        using std::swap;
-        swap(x.vchan, y.vchan);
-        swap(x.echan, y.echan);
-        swap(x.isready, y.isready);
-    }
+    inline friend void swap(Future& x, Future& y) { swap(x.statep, y.statep); }
 
     // Result Access
     Awaitable   get();
@@ -1513,31 +2122,25 @@ public:
     bool is_valid() const;
 
     // Comparisons
-    inline friend bool operator==(const Future& x, const Future& y) {
-        if (x.vchan != y.vchan) return false;
-        if (x.echan != y.echan) return false;
-        if (x.isready != y.isready) return false;
-        return true;
-    }
+    inline friend bool operator==(const Future& x, const Future& y) { return x.statep == y.statep; }
 
     // Friends
     friend class Awaitable;
     friend class Task;
+    friend class All_futures_awaitable<T>;
+    friend class Any_future_awaitable<T>;
 
 private:
     // Result Access
     bool    is_ready() const;
     T       get_ready();
+    bool    run_deferred() const;
 
     // Task Waiting
-    Channel_base*   value_channel() const;
-    Channel_base*   error_channel() const;
-    bool*           ready_flag() const;
+    Future_state_base* state() const;
 
     // Data
-    Value_receiver  vchan;
-    Error_receiver  echan;
-    mutable bool    isready;
+    State_ptr statep;
 };
 
 
@@ -1560,10 +2163,7 @@ private:
     Awaitable(Future*);
 
     // Data
-    Future*             selfp;
-    T                   v;
-    exception_ptr       ep;
-    Channel_operation   ops[2];
+    Future* selfp;
 };
 
 
@@ -1575,13 +2175,13 @@ class Future<void> : boost::equality_comparable<Future<void>> {
 public:
     // Names/Types
     class Awaitable;
-    using Value             = void;
-    using Value_receiver    = Receive_channel<void>;
-    using Error_receiver    = Receive_channel<exception_ptr>;
+    using Value     = void;
+    using State     = Future_state<void>;
+    using State_ptr = boost::intrusive_ptr<State>;
 
     // Construct/Copy
-    Future();
-    Future(Value_receiver, Error_receiver);
+    Future() = default;
+    explicit Future(State_ptr);
     Future(const Future&) = delete;
     Future& operator=(const Future&) = delete;
     Future(Future&&);
@@ -1604,21 +2204,20 @@ public:
     // Friends
     friend class Awaitable;
     friend class Task;
+    friend class All_futures_awaitable<void>;
+    friend class Any_future_awaitable<void>;
 
 private:
     // Result Access
     bool is_ready() const;
     void get_ready();
+    bool run_deferred() const;
 
     // Task Waiting
-    Channel_base*   value_channel() const;
-    Channel_base*   error_channel() const;
-    bool*           ready_flag() const;
+    Future_state_base* state() const;
 
     // Data
-    Value_receiver  vchan;
-    Error_receiver  echan;
-    mutable bool    isready;
+    State_ptr statep;
 };
 
 
@@ -1640,9 +2239,7 @@ private:
     Awaitable(Future*);
 
     // Data
-    Future*             selfp;
-    exception_ptr       ep;
-    Channel_operation   ops[2];
+    Future* selfp;
 };
 
 
@@ -1752,14 +2349,38 @@ public:
 
 private:
     // Construct
-    static Time_channel make_timer(Scheduler*, Duration);
+    static Time_channel make_timer(Scheduler*, Duration, Alarm_id*);
     static bool         is_valid(Duration);
 
     // Data
-    Time_channel chan;
+    Scheduler*      schedp{nullptr};
+    Alarm_id        alarm;  // initialized before chan by make_timer()
+    Time_channel    chan;
 };
 
 
+/*
+    Yield Awaitable
+
+    Suspends the running task if its time slice has expired, leaving it
+    ready to run again behind other ready tasks.
+*/
+class Yield_awaitable {
+public:
+    // Awaitable Operations
+    bool await_ready();
+    bool await_suspend(Task::Handle);
+    void await_resume();
+};
+
+
+/*
+    Time Slicing
+*/
+Yield_awaitable yield_if_needed();
+Duration        this_task_run_time();
+
+
 /*
     Scheduler
 
@@ -1770,16 +2391,65 @@ private:
 */
 class Scheduler {
 public:
+    /*
+        Worker Placement
+
+        Floating workers run wherever the operating system puts them.
+        Pinned workers are each bound to one of the process's CPUs, grouped
+        by NUMA node (the workers of a node have consecutive indexes).  A
+        pinned worker steals from workers on its own node before others,
+        and frees surplus task frames to a pool shared by its node, from
+        which tasks started with a hint for that node get their frames.
+    */
+    enum class Worker_placement : int { floating, pinned };
+
     // Construct/Destroy
-    explicit Scheduler(int nthreads=0);
+    explicit Scheduler(int nthreads=0, Worker_placement=Worker_placement::floating);
     Scheduler(const Scheduler&) = delete;
     Scheduler& operator=(const Scheduler&) = delete;
     ~Scheduler();
 
-    // Task Execution
-    void submit(Task);
+    /*
+        Task Execution
+
+        A task belongs to the Scheduler to which it's submitted, which
+        resumes it whenever it's woken (e.g., by a channel or a timer).  The
+        non-member start() functions (and async()) submit to the Scheduler
+        of the calling worker, or to the global Scheduler if the caller
+        isn't a worker, so tasks started by a task stay with its Scheduler.
+        A task woken by the task running on a worker runs next on that
+        worker (unless it's less urgent), so a pair of communicating tasks
+        can hand off to each other without leaving the core.
+    */
+    void submit(Task, Task_priority=Task_priority::normal);
     void resume(Task::Promise*);
 
+    template<class TaskFun, class... Args> void start(TaskFun, Args&&...);
+    template<class TaskFun, class... Args> void start(Task_priority, TaskFun, Args&&...);
+    template<class TaskFun, class... Args> void start(Node_hint, TaskFun, Args&&...);
+    template<class TaskFun, class... Args> void start(Task_priority, Node_hint, TaskFun, Args&&...);
+
+    static Scheduler& this_scheduler();
+
+    /*
+        Task Priorities
+
+        Each worker keeps a lane of ready tasks for each priority, as does
+        the queue of tasks submitted from other threads.  Under the strict
+        policy, a worker always runs the most urgent task it can find.
+        Under the weighted policy (the default), a worker favors each lane
+        in proportion to its weight (critical 12, normal 3, background 1)
+        and falls back to the most urgent lane that isn't empty, so that
+        less urgent tasks can't be starved.
+    */
+    enum class Priority_policy : int { strict, weighted };
+
+    void            priority_policy(Priority_policy);
+    Priority_policy priority_policy() const;
+
+    // NUMA Nodes
+    int node_count() const;
+
     /* 
         Timers
 
@@ -1792,11 +2462,59 @@ public:
         (resume/suspend) from components requiring synchronization (e.g.,
         channel I/O, future waiting), that could be a big help.
     */
-    void start_timer(Task::Promise*, Duration);
-    void cancel_timer(Task::Promise*);
+    Alarm_id    start_timer(Task::Promise*, Duration);
+    bool        cancel_timer(Alarm_id);
+
+    /*
+        Coroutine Frames
+
+        Task frames (and channels and future states) are recycled through
+        a pool local to each worker thread.  The statistics count the
+        blocks allocated by the workers and how many of them were found in
+        a pool.
+    */
+    struct Frame_statistics {
+        std::uint64_t allocations;
+        std::uint64_t hits;
+    };
+
+    Frame_statistics frame_statistics() const;
+
+    /*
+        Random Selection
+
+        When several channel operations or futures are ready, a task
+        chooses among them at random, using a generator local to the thread
+        on which it runs.  The generators are seeded from a value chosen at
+        random when the Scheduler is constructed.  Seeding the Scheduler
+        explicitly makes the choices reproducible (e.g., in benchmarks):
+        before its next choice, each worker reseeds its generator from the
+        given value and the worker's index.
+    */
+    void seed_random(std::uint64_t);
+
+    /*
+        Time Slicing
+
+        Tasks are scheduled cooperatively, so a task that computes for long
+        stretches should offer to yield by awaiting yield_if_needed().  The
+        task yields only if it has run for longer than the time slice since
+        it was resumed.  A task that yields is queued behind all other
+        ready tasks, including tasks submitted from outside the Scheduler,
+        so that it can't delay them by more than a slice.  The Scheduler
+        also accounts the time that each task runs.
+    */
+    void        time_slice(Duration);
+    Duration    time_slice() const;
 
     // Friends
     friend class Timer;
+    friend class Task;
+    friend class Task::Promise;
+    template<class T> friend class Channel;
+    friend class Future_state_base;
+    friend class Yield_awaitable;
+    friend Duration this_task_run_time();
 
 private:
     // Names/Types
@@ -1804,6 +2522,15 @@ private:
     using Mutex     = std::mutex;
     using Lock      = std::unique_lock<Mutex>;
     using Condition = std::condition_variable;
+    using Clock     = std::chrono::steady_clock;
+
+    // Constants
+    static const std::size_t    cache_line_size{64};
+    static const Duration::rep  default_slice_ns{10000000};    // 10 ms
+
+    // Forward Declarations
+    class Timers;
+    using Timer_vector = std::vector<Timers>;
 
     /*
         TODO:  Should be a resusable internal library component parameterized
@@ -1822,8 +2549,114 @@ private:
         Lock* lockp;
     };
 
-    // TODO: Consider using values rather than rvalue references as sinks
-    // in the Task_queue interfaces below?
+    /*
+        Task Deque
+
+        A Chase-Lev work-stealing deque.  The worker owning the deque pushes
+        and pops tasks at the bottom (LIFO) while other workers steal tasks
+        from the top (FIFO).  Only the owner may push or pop, but any thread
+        may steal.  Storage grows as needed; arrays outgrown by the owner are
+        retained until the deque is destroyed because thieves can still be
+        reading from them.
+    */
+    class Task_deque {
+    public:
+        // Construct/Copy/Destroy
+        Task_deque();
+        Task_deque(const Task_deque&) = delete;
+        Task_deque& operator=(const Task_deque&) = delete;
+        ~Task_deque();
+
+        // Size
+        bool is_empty() const;
+
+        // Owner Operations
+        void push(Task&&);
+        Task pop();
+
+        // Thief Operations
+        Task steal();
+
+    private:
+        // Names/Types
+        using Index = std::int64_t;
+        using Slot  = std::atomic<void*>;
+
+        class Array {
+        public:
+            // Construct/Copy
+            explicit Array(Index n);
+            Array(const Array&) = delete;
+            Array& operator=(const Array&) = delete;
+
+            // Size
+            Index size() const;
+
+            // Element Access
+            void*   get(Index i) const;
+            void    put(Index i, void* taskp);
+
+            // Growth
+            std::unique_ptr<Array> grow(Index top, Index bottom) const;
+
+        private:
+            // Data
+            Index                   mask;   // size - 1 (size is a power of 2)
+            std::unique_ptr<Slot[]> slots;
+        };
+
+        using Array_ptr     = std::unique_ptr<Array>;
+        using Array_vector  = std::vector<Array_ptr>;
+
+        // Constants
+        static const Index initial_size{64};
+
+        // Task Construction
+        static Task make_task(void* taskp);
+
+        // Data
+        std::atomic<Index>  top;
+        char                toppad[cache_line_size - sizeof(std::atomic<Index>)];
+        std::atomic<Index>  bottom;
+        std::atomic<Array*> arrayp;
+        Array_vector        arrays; // current and retired, owner access only
+    };
+
+    /*
+        Task Slot
+
+        The task that a worker runs next, which was woken by the task the
+        worker is running.  Only the owner puts tasks in the slot, but any
+        thread may take them.
+    */
+    class Task_slot {
+    public:
+        // Construct/Copy/Destroy
+        Task_slot() = default;
+        Task_slot(const Task_slot&) = delete;
+        Task_slot& operator=(const Task_slot&) = delete;
+        ~Task_slot();
+
+        // Owner Operations
+        Task exchange(Task&&);
+
+        // Thief Operations
+        Task take();
+
+    private:
+        // Data
+        std::atomic<void*>  taskp{nullptr};
+        char                pad[cache_line_size - sizeof(std::atomic<void*>)];
+    };
+
+    /*
+        Task Queue
+
+        A FIFO queue of tasks shared by all workers.  One receives tasks
+        submitted from threads that aren't workers (which can't push to a
+        deque), and another receives tasks that yield, so that they run
+        behind other work.
+    */
     class Task_queue {
     public:
         // Construct/Copy
@@ -1831,102 +2664,250 @@ private:
         Task_queue(const Task_queue&) = delete;
         Task_queue& operator=(const Task_queue&) = delete;
 
+        // Size
+        bool is_empty() const;
+
         // Queue Operations
         void push(Task&&);
-        Task pop();
-        bool try_push(Task&&);
         Task try_pop();
-        void interrupt();
     
     private:
         // Queue Operations
         static Task pop_front(std::deque<Task>*);
     
         // Data
-        std::deque<Task>    tasks;
-        bool                is_interrupt{false};
-        mutable Mutex       mutex;
-        Condition           ready;
+        std::deque<Task>            tasks;
+        std::atomic<std::size_t>    ntasks{0};
+        mutable Mutex               mutex;
     };
 
+    /*
+        Task Queues
+
+        The ready tasks of each worker, plus the shared queues, with a lane
+        for each priority.  A worker visits the lanes in an order set by the
+        priority policy.  For each lane, it runs its own tasks and then
+        submitted tasks; failing those, it steals from other workers
+        (again lane by lane), and only then runs tasks that have yielded.
+        The shared queues are also checked periodically so that they can't
+        be starved.
+
+        Ahead of its lanes, a worker runs the task in its next slot (a task
+        woken by the one it just ran), which displaces any earlier occupant
+        to the worker's deque.  After a limited run of tasks from the slot,
+        the worker turns to its lanes first, so a pair of tasks that wake
+        each other can't starve its other tasks.  Spinning workers take
+        tasks from the slots of busy workers as a last resort.
+
+        A worker that runs out of tasks spins (searches the queues) for a
+        while before it parks on the alarm clock of its timers, so it wakes
+        for either new work or its next alarm.  At most half the workers
+        spin at once.  Parked workers form a stack, and a push wakes the
+        most recently parked worker only if nobody is spinning, in which
+        case the woken worker counts as spinning from the outset.  A worker
+        that stops spinning because it found a task wakes another if it was
+        the last spinner, so a burst of pushes ramps up the workers one at
+        a time rather than waking all of them at once.
+    */
     class Task_queues {
     private:
         // Names/Types
-        using Queue_vector = std::vector<Task_queue>;
+        using Deque_vector = std::vector<Task_deque>;
 
     public:
         // Names/Types
-        using Size = Queue_vector::size_type;
+        using Size = Deque_vector::size_type;
     
         // Construct/Copy
-        explicit Task_queues(Size nqueues);
+        explicit Task_queues(Timer_vector*);
         Task_queues(const Task_queues&) = delete;
         Task_queues& operator=(const Task_queues&) = delete;
     
         // Size
         Size size() const;
+
+        // Worker Threads
+        void        place(Size q, unsigned node);
+        unsigned    node(Size q) const;
+        void        attach(Size q);
+        Size        this_queue() const;    // size() if not a worker
     
         // Queue Operations
         void push(Task&&);
-        void push(Size qpref, Task&&);
-        Task pop(Size qpref);
+        void push_next(Task&&);
+        void yield(Task&&);
+        Task pop(Size q);
         void interrupt();
 
+        // Priority Policy
+        void            policy(Priority_policy);
+        Priority_policy policy() const;
+
     private:
+        // Names/Types
+        struct Worker {
+            const Task_queues*  queuesp{nullptr};
+            Size                queue{0};
+            unsigned            ticks{0};
+            unsigned            laneticks{0};
+            unsigned            nexts{0};   // consecutive runs from the slot
+            bool                is_spinning{false};
+            std::minstd_rand    random;
+        };
+
+        struct Idle_link {
+            Size    prev;
+            Size    next;
+            bool    is_idle{false};
+        };
+
+        // Constants
+        static const unsigned   global_interval{61};
+        static const int        spin_rounds{16};
+        static const Size       nlanes{3};  // one per Task_priority
+        static const unsigned   critical_weight{12};
+        static const unsigned   normal_weight{3};
+        static const unsigned   background_weight{1};
+        static const unsigned   lane_period{critical_weight + normal_weight + background_weight};
+        static const unsigned   next_limit{32};
+
+        // Worker Threads
+        static Worker& this_worker();
+
+        // Lanes
+        static Size lane(Task_priority);
+        void        order_lanes(Worker*, Size* lanesp) const;
+        Task_deque& deque(Size q, Size lane);
+
         // Queue Operations
-        static void push(Queue_vector*, Size qpref, Task&&);
+        Task try_pop(Worker*);
+        Task spin(Worker*);
+        Task steal(Worker*, Size lane);
+        Task steal_next(Worker*);
+        bool wait(Worker*);
+        void notify();
+        bool is_empty() const;
+
+        // Spinning Workers
+        bool start_spinning(Worker*);
+        void stop_spinning(Worker*, bool is_found);
+
+        // Idle Workers (with the mutex locked)
+        void push_idle(Size q);
+        void erase_idle(Size q);
+        Size pop_idle();
 
         // Data
-        Queue_vector        qs;
-        std::atomic<Size>   nextq{0};
+        Size                            nworkers;
+        std::vector<unsigned>           nodes;      // of each worker
+        Deque_vector                    deques;     // nlanes per worker
+        std::vector<Task_slot>          slots;      // one per worker
+        Task_queue                      global[nlanes];
+        Task_queue                      yielded;
+        std::atomic<Priority_policy>    lanepolicy{Priority_policy::weighted};
+        Timer_vector*                   timersp;
+        std::vector<Idle_link>          idlers;     // stack linked by worker
+        Size                            idletop;
+        std::atomic<int>                nidle{0};
+        std::atomic<int>                nspinning{0};
+        std::atomic<bool>               is_interrupt{false};
+        mutable Mutex                   mutex;
     };
 
+    /*
+        Waiting Tasks
+
+        Suspended tasks are owned by the Scheduler until they are resumed.
+        Each is linked into one of several shards (selected by address) via
+        the intrusive link in its promise, so insertion and release take
+        constant time and contend only on the shard's lock.
+    */
     class Waiting_tasks {
     public:
-        // Construct/Copy
+        // Construct/Copy/Destroy
         Waiting_tasks() = default;
         Waiting_tasks(const Waiting_tasks&) = delete;
         Waiting_tasks& operator=(const Waiting_tasks&) = delete;
+        ~Waiting_tasks();
 
         // Task Operations
         void insert(Task&&);
-        Task release(Task::Handle);
+        Task release(Task::Promise*);
     
     private:
         // Names/Types
-        struct handle_eq {
-            // Construct
-            explicit handle_eq(Task::Handle);
-            bool operator()(const Task&) const;
-            Task::Handle h;
+        class Task_list {
+        public:
+            // Construct/Copy
+            Task_list() = default;
+            Task_list(const Task_list&) = delete;
+            Task_list& operator=(const Task_list&) = delete;
+
+            // List Operations
+            void            push(Task::Promise*);
+            bool            erase(Task::Promise*);
+            Task::Promise*  pop();
+
+        private:
+            // Links
+            static Task::Waiting_link& link(Task::Promise*);
+
+            // Data
+            Task::Promise* headp{nullptr};
         };
+
+        struct Shard {
+            Task_list       tasks;
+            mutable Mutex   mutex;
+        };
+
+        // Constants
+        static const int nshards{64};
+
+        // Shard Selection
+        Shard& shard(Task::Promise*);
     
         // Data
-        std::vector<Task>   tasks;
-        mutable Mutex       mutex;
+        Shard shards[nshards];
     };
 
+    /*
+        Timers
+
+        The alarms armed by a worker.  The worker processes its expired
+        alarms between tasks and while it's parked, so the tasks they
+        wake resume on that worker.  Other threads can start and cancel
+        alarms concurrently.
+    */
     class Timers {
     public:
-        // Construct/Copy/Destroy
-        Timers();
+        // Construct/Copy
+        Timers() = default;
         Timers(const Timers&) = delete;
         Timers& operator=(const Timers&) = delete;
-        ~Timers();
+
+        // Worker Threads
+        void attach(std::uint32_t worker);
 
         // Future Wait Timers
-        void start(Task::Promise*, Duration);
-        void cancel(Task::Promise*);
+        Alarm_id    start(Task::Promise*, Duration);
+        bool        cancel(Alarm_id);
 
         // User Timers
-        void start(const Time_channel&, Duration);
-        bool reset(const Time_channel&, Duration);
-        bool stop(const Time_channel&);
+        Alarm_id    start(const Time_channel&, Duration);
+        bool        reset(Alarm_id, Duration);
+        bool        stop(Alarm_id);
+
+        // Alarm Processing
+        void process_ready();
+        void wait();
+        void interrupt() const;
 
     private:
         /*
             The clock should be monotonic with adequate resolution.
-            std::chrono::steady_clock has nanosecond resolution on Windows.
+            std::chrono::steady_clock has nanosecond resolution on Windows
+            and Linux.
         */
         using Clock = std::chrono::steady_clock;
 
@@ -1937,167 +2918,358 @@ private:
                 Alarm a = make_alarm(xxx);
                 a.expire(now);
         */
-        struct Alarm : boost::totally_ordered<Alarm> {
+        struct Alarm {
             // Construct
             Alarm() = default;
             Alarm(Task::Promise* tskp, Time t) : taskp{tskp}, time{t} {}
             Alarm(Time_channel c, Time t)
                 : taskp{nullptr}, channel{std::move(c)}, time{t} {}
 
-            // Comparisons
-            inline friend bool operator==(const Alarm& x, const Alarm& y) {
-                if (x.taskp != y.taskp) return false;
-                if (x.channel != y.channel) return false;
-                if (x.time != y.time) return false;
-                return true;
-            }
-
-            inline friend bool operator< (const Alarm& x, const Alarm& y) {
-                return x.time < y.time;
-            }
-
             // Data
             Task::Promise*  taskp;
             Time_channel    channel;
             Time            time;
          };
 
-        class Alarm_queue {
-        private:
-            // Names/Types
-            using Alarm_deque = std::deque<Alarm>;
-
-            struct Task_eq {
-                explicit Task_eq(Task::Promise* tp) : taskp{tp} {}
-                bool operator()(const Alarm& a) const {
-                    return a.taskp == taskp;
-                }
-                Task::Promise* taskp;
-            };
-
-            struct Channel_eq {
-                explicit Channel_eq(const Time_channel& c) : chan{c} {}
-                bool operator()(const Alarm& a) const {
-                    return a.channel == chan;
-                }
-                const Time_channel& chan;
-            };
-
-            // Alarm Comparison
-            static Task_eq      id_eq(Task::Promise*);
-            static Channel_eq   id_eq(const Time_channel&);
-
-            // Data
-            Alarm_deque alarms;
+        /*
+            Alarm Queue
 
+            A 4-ary min-heap of alarms ordered by expiry.  Alarms live in
+            slots that record their position in the heap, so an Alarm_id
+            leads straight to its alarm and canceling or rescheduling one
+            needs no search.  Vacated slots are recycled.
+        */
+        class Alarm_queue {
         public:
-            // Names/Types
-            using Iterator          = Alarm_deque::iterator;
-            using Const_iterator    = Alarm_deque::const_iterator;
-
-            // Iterators
-            Iterator begin();
-            Iterator end();
+            // Worker Threads
+            void attach(std::uint32_t worker);
 
             // Size
             int     size() const;
             bool    is_empty() const;
 
             // Queue Functions
-            Iterator    push(const Alarm&);
-            void        reschedule(Iterator, Time expiry);
+            Alarm_id    push(Alarm&&);
             Alarm       pop();
-            void        erase(Iterator);
+            bool        erase(Alarm_id);
+            bool        reschedule(Alarm_id, Time expiry);
 
             // Element Access
-            const Alarm&                front() const;
-            template<class T> Iterator  find(const T& alarmid);
+            const Alarm& front() const;
 
             // Observers
             Time next_expiry() const;
+
+        private:
+            // Names/Types
+            using Index     = std::uint32_t;
+            using Position  = std::size_t;
+
+            struct Slot {
+                Alarm           alarm;
+                Position        pos{0};     // in the heap
+                std::uint32_t   serial{0};
+                bool            is_used{false};
+            };
+
+            // Constants
+            static const Position arity{4};
+
+            // Slot Management
+            Index       allocate(Alarm&&);
+            void        release(Index);
+            Slot*       lookup(Alarm_id);
+            const Slot* lookup(Alarm_id) const;
+
+            // Heap Operations
+            void    place(Position, Index);
+            void    remove(Position);
+            void    restore(Position);
+            void    sift_up(Position);
+            void    sift_down(Position);
+            Time    expiry(Position) const;
+
+            // Data
+            std::vector<Slot>   slots;
+            std::vector<Index>  freeslots;
+            std::vector<Index>  heap;
+            std::uint32_t       owner{0};
         };
 
-        using Windows_handle = HANDLE;
+        enum class Clock_event : int { alarm, interrupt };
+
+        /*
+            Alarm Clock
 
-        enum : int { timer_handle, interrupt_handle };
+            A one-shot operating system timer, armed for the earliest
+            alarm, and an interrupt signal, either of which can wake the
+            parked worker.  The clock remembers its deadline so that arming
+            it again for the same time costs nothing.
 
-        class Windows_handles {
+            On Windows, the clock is a waitable timer and an event.  On
+            Linux, it's a timerfd and an eventfd multiplexed by epoll.  The
+            timerfd uses CLOCK_MONOTONIC (the steady_clock's epoch), so
+            deadlines are set as absolute times with nanosecond resolution.
+        */
+        class Alarm_clock {
         public:
             // Construct/Copy/Destroy
-            Windows_handles();
-            Windows_handles(const Windows_handles&) = delete;
-            Windows_handles& operator=(const Windows_handles&) = delete;
-            ~Windows_handles();
+            Alarm_clock();
+            Alarm_clock(const Alarm_clock&) = delete;
+            Alarm_clock& operator=(const Alarm_clock&) = delete;
+            ~Alarm_clock();
 
-            // Synchronization
-            int     wait_any(Lock*) const;
-            void    signal_interrupt() const;
+            // Timer Functions
+            void set(Time expiry);
+            void cancel();
 
-            // Observers
-            Windows_handle timer() const;
+            // Synchronization
+            Clock_event wait(Lock*);
+            void        interrupt() const;
 
         private:
-            // Constants
-            static const int count{2};
-
-            // Destroy
-            static void close(Windows_handle* hs, int n = count);
+            // Operating System Interface
+            void        arm(Time expiry) const;
+            void        disarm() const;
+            Clock_event wait_any() const;
+            void        close();
 
             // Data
-            Windows_handle hs[count];
+#if defined _WIN32
+            enum : int { timer_handle, interrupt_handle };
+            static const int count{2};
+            HANDLE          hs[count];
+#else
+            int             epollfd;
+            int             timerfd;
+            int             eventfd;
+#endif
+            optional<Time>  deadline;
         };
 
-        // Execution
-        void run_thread();
+        // Constants
+        static const Duration::rep never{std::numeric_limits<Duration::rep>::max()};
 
         // Alarm Management
-        template<class T> void          sync_start(const T& id, Duration);
-        template<class T> static void   start_alarm(const T& id, Duration, Alarm_queue*, Windows_handle timer);
-        template<class T> bool          sync_cancel(const T& id);
-        static bool                     cancel(Task::Promise*, Alarm_queue::Iterator, Alarm_queue*, Windows_handle timer);
-        static bool                     cancel(Time_channel, Alarm_queue::Iterator, Alarm_queue*, Windows_handle timer);
-        static void                     remove_canceled(Alarm_queue::Iterator, Alarm_queue*, Windows_handle timer);
-        static void                     reschedule(Alarm_queue::Iterator, Duration, Alarm_queue*, Windows_handle timer);
+        Alarm_id    start_alarm(Alarm&&);
+        void        update_clock();
 
          // Ready Alarm Processing
-        static void process_ready(Alarm_queue*, Windows_handle timer, Lock*);
         static void signal_ready(Alarm_queue*, Time now, Lock*);
         static void signal_ready(const Alarm&, Time now, Lock*);
         static void signal_alarm(Task::Promise*, Time now, Lock*);
         static void signal_alarm(const Time_channel&, Time now);
         static bool notify_timer_expired(Task::Promise*, Time now, Lock*);
         static bool is_ready(const Alarm&, Time now);
-
-        // Timer Functions
-        static void set_timer(Windows_handle timer, const Alarm&, Time now);
-        static void cancel_timer(Windows_handle timer);
+        static bool is_ready(Duration::rep expiry, Time now);
 
         // Data
-        Alarm_queue     alarmq;
-        Windows_handles handles;
-        mutable Mutex   mutex;
-        Thread          thread;
+        Alarm_queue                 alarmq;
+        Alarm_clock                 clock;
+        bool                        is_parked{false};
+        std::atomic<Duration::rep>  nextexpiry{never};
+        mutable Mutex               mutex;
     };
     
+    /*
+        Frame Pool
+
+        Coroutine frames and other small shared objects (channels, future
+        states) freed by a worker, binned by size class (a whole number of
+        cache lines), for reuse by the same worker.  A block can be freed on
+        a different worker than allocated it, so every block in a class is
+        allocated at the class size.  Bins are bounded and blocks too large
+        for any class bypass the pool.
+    */
+    class Frame_pool {
+    public:
+        // Construct/Copy/Destroy
+        Frame_pool() = default;
+        Frame_pool(const Frame_pool&) = delete;
+        Frame_pool& operator=(const Frame_pool&) = delete;
+        ~Frame_pool();
+
+        // Allocation
+        void*               allocate(std::size_t n);
+        bool                deallocate(void* p, std::size_t n);
+        static std::size_t  block_size(std::size_t n);
+
+        // Observers
+        Frame_statistics statistics() const;
+
+    private:
+        // Names/Types
+        struct Frame {
+            Frame* nextp;
+        };
+
+        struct Bin {
+            Frame*      headp{nullptr};
+            std::size_t size{0};
+        };
+
+        // Constants
+        static const std::size_t nclasses{32};
+        static const std::size_t bin_capacity{256};
+
+        // Size Classes
+        static std::size_t size_class(std::size_t n);
+        static std::size_t class_size(std::size_t c);
+
+        // Statistics
+        static void count(std::atomic<std::uint64_t>*);
+
+        // Data
+        Bin                         bins[nclasses];
+        std::atomic<std::uint64_t>  nallocs{0};
+        std::atomic<std::uint64_t>  nhits{0};
+    };
+
+    /*
+        Node Pool
+
+        Frames freed by the workers of a NUMA node that overflow their own
+        pools, shared by the node's workers and by tasks started (on any
+        thread) with a hint for the node.
+    */
+    class Node_pool {
+    public:
+        // Construct/Copy
+        Node_pool() = default;
+        Node_pool(const Node_pool&) = delete;
+        Node_pool& operator=(const Node_pool&) = delete;
+
+        // Allocation
+        void*   allocate(std::size_t n);
+        bool    deallocate(void* p, std::size_t n);
+
+    private:
+        // Data
+        Frame_pool  pool;
+        Mutex       mutex;
+    };
+
+    /*
+        Node Sentry
+
+        Directs the frame allocations of the calling thread to the pool of
+        a NUMA node for the sentry's lifetime.
+    */
+    class Node_sentry {
+    public:
+        // Construct/Copy/Destroy
+        Node_sentry(Scheduler*, Node_hint);
+        Node_sentry(const Node_sentry&) = delete;
+        Node_sentry& operator=(const Node_sentry&) = delete;
+        ~Node_sentry();
+
+    private:
+        // Data
+        Node_pool* prevhintp;
+    };
+
+    /*
+        CPU
+
+        A processor available to the process and its NUMA node.
+    */
+    struct Cpu {
+        unsigned id;
+        unsigned node;
+    };
+
+    using Cpu_vector = std::vector<Cpu>;
+
+    /*
+        Random Engine
+
+        An xorshift64* generator, which is small and fast enough to consult
+        on every selection.  Each thread has its own, which records the
+        seeding epoch of the Scheduler from which it was last seeded.
+    */
+    class Random_engine {
+    public:
+        // Seeding
+        void        seed(std::uint64_t, unsigned epoch);
+        unsigned    epoch() const;
+
+        // Generation
+        std::uint64_t operator()();
+
+    private:
+        // Data
+        std::uint64_t   state{1};
+        unsigned        seedepoch{~0u};
+    };
+
+    /*
+        Time Slice
+
+        The task running on a worker thread and its current slice.
+    */
+    struct Time_slice {
+        Task::Promise*  taskp{nullptr};
+        Time            start;
+        Time            end;
+    };
+
     // Task Execution
     void run_tasks(unsigned q);
 
+    // Time Slicing
+    static Time_slice&  this_time_slice();
+    static bool         is_slice_expired();
+
+    // Random Selection
+    Channel_size            random(Channel_size min, Channel_size max);
+    static std::uint64_t    mix(std::uint64_t);
+    static Random_engine&   this_random_engine();
+
+    // Coroutine Frames
+    static void*        allocate_frame(std::size_t n);
+    static void         deallocate_frame(void* p, std::size_t n);
+    static Frame_pool*& this_frame_pool();
+    static Node_pool*&  this_node_pool();
+    static Node_pool*&  this_node_hint();
+
+    // Worker Threads
+    static Scheduler*&  this_worker_scheduler();
+
+    // Worker Placement
+    static Cpu_vector   available_cpus();
+    static void         pin_this_thread(unsigned cpu);
+
     // User Timers
-    void start_timer(const Time_channel&, Duration);
-    bool stop_timer(const Time_channel&);
-    bool reset_timer(const Time_channel&, Duration);
+    Alarm_id    start_timer(const Time_channel&, Duration);
+    bool        stop_timer(Alarm_id);
+    bool        reset_timer(const Time_channel&, Alarm_id*, Duration);
+
+    // Timer Selection
+    Timers& this_timers();
+    Timers* find_timers(Alarm_id);
 
     // Data
-    Task_queues         ready;
-    Waiting_tasks       waiting;
-    Timers              timers;
-    std::vector<Thread> threads;
+    Timer_vector                    timers;
+    Task_queues                     ready;
+    Waiting_tasks                   waiting;
+    std::vector<Frame_pool>         pools;
+    std::unique_ptr<Node_pool[]>    nodepools;
+    unsigned                        nnodes{1};
+    std::atomic<std::uint64_t>      randseed;
+    std::atomic<unsigned>           randepoch{0};
+    std::atomic<std::uint32_t>      nextworker{0};
+    std::atomic<Duration::rep>      slicens{default_slice_ns};
+    std::vector<Thread>             threads;
 };
 
 
 /*
     The Global Scheduler
 
+    The Scheduler of tasks started by threads that aren't workers.  Other
+    Schedulers can be constructed to isolate groups of tasks (e.g., to run
+    latency-critical tasks on a small dedicated pool of workers).
+
     TODO: Investigate the merits of supporting distinct scheduling
     implementations.
 */
@@ -24,6 +24,73 @@ namespace Isptech   {
 namespace Coroutine {
 
 
+/*
+    Alarm Identifier
+*/
+inline
+Alarm_id::Alarm_id(std::uint32_t worker, std::uint32_t slot, std::uint32_t serial)
+    : workernum{worker}
+    , slotnum{slot}
+    , serialnum{serial}
+{
+}
+
+
+inline
+Alarm_id::operator bool() const
+{
+    return serialnum != 0;
+}
+
+
+inline std::uint32_t
+Alarm_id::serial() const
+{
+    return serialnum;
+}
+
+
+inline std::uint32_t
+Alarm_id::slot() const
+{
+    return slotnum;
+}
+
+
+inline std::uint32_t
+Alarm_id::worker() const
+{
+    return workernum;
+}
+
+
+inline bool
+operator==(Alarm_id x, Alarm_id y)
+{
+    if (x.workernum != y.workernum) return false;
+    if (x.slotnum != y.slotnum) return false;
+    if (x.serialnum != y.serialnum) return false;
+    return true;
+}
+
+
+/*
+    NUMA Node Hint
+*/
+inline
+Node_hint::Node_hint(int node)
+    : nodenum{node}
+{
+}
+
+
+inline int
+Node_hint::node() const
+{
+    return nodenum;
+}
+
+
 /*
     Task Channel Lock
 */
@@ -68,129 +135,121 @@ Task::Select_status::operation() const
 
 
 /*
-    Task Future Selector Channel Wait
+    Task Future Selector State Wait
 */
 inline
-Task::Future_selector::Channel_wait::Channel_wait(Channel_base* channelp, Channel_size future)
-    : chanp{channelp}
+Task::Future_selector::State_wait::State_wait(Future_state_base* sp, Channel_size future)
+    : statep{sp}
     , fpos{future}
 {
 }
 
 
-inline Channel_base*
-Task::Future_selector::Channel_wait::channel() const
-{
-    return chanp;
-}
-
-
 inline void
-Task::Future_selector::Channel_wait::complete() const
+Task::Future_selector::State_wait::complete() const
 {
     is_enq = false;
 }
 
 
 inline void
-Task::Future_selector::Channel_wait::dequeue(Task::Promise* taskp, Channel_size pos) const
+Task::Future_selector::State_wait::dequeue(Task::Promise* taskp, Channel_size pos) const
 {
-    if (is_enq && chanp->dequeue_readable_wait(taskp, pos))
+    if (is_enq && statep->dequeue_readable_wait(taskp, pos))
         is_enq = false;
 }
 
 
 inline void
-Task::Future_selector::Channel_wait::enqueue(Task::Promise* taskp, Channel_size pos) const
+Task::Future_selector::State_wait::enqueue(Task::Promise* taskp, Channel_size pos) const
 {
-    chanp->enqueue_readable_wait(taskp, pos);
+    statep->enqueue_readable_wait(taskp, pos);
     is_enq = true;
 }
 
 
 inline Channel_size
-Task::Future_selector::Channel_wait::future() const
+Task::Future_selector::State_wait::future() const
 {
     return fpos;
 }
 
 
 inline bool
-Task::Future_selector::Channel_wait::is_enqueued() const
+Task::Future_selector::State_wait::is_enqueued() const
 {
     return is_enq;
 }
 
 
 inline bool
-Task::Future_selector::Channel_wait::is_ready() const
+Task::Future_selector::State_wait::is_ready() const
 {
-    return chanp->is_readable();
+    return statep->is_ready();
+}
+
+
+inline Future_state_base*
+Task::Future_selector::State_wait::state() const
+{
+    return statep;
 }
 
 
 /*
     Task Future Selector Future Wait
-
-    TODO:  Change vchan/echan to vwait/ewait everywhere appropriate?
 */
 inline
-Task::Future_selector::Future_wait::Future_wait(bool* readyp, Channel_size vchan, Channel_size echan)
-    : signalp{readyp}
-    , vpos{vchan}
-    , epos{echan}
+Task::Future_selector::Future_wait::Future_wait(Future_state_base* sp, Channel_size wait)
+    : statep{sp}
+    , pos{wait}
 {
 }
 
 
-inline void
-Task::Future_selector::Future_wait::enqueue(Task::Promise* taskp, const Channel_waits& chans) const
+inline bool
+Task::Future_selector::Future_wait::complete(const State_waits& waits) const
 {
-    chans[vpos].enqueue(taskp, vpos);
-    chans[epos].enqueue(taskp, epos);
+    waits[pos].complete();
+    return true;
 }
 
 
-inline Channel_size
-Task::Future_selector::Future_wait::error() const
+inline void
+Task::Future_selector::Future_wait::enqueue(Task::Promise* taskp, const State_waits& waits) const
 {
-    return epos;
+    waits[pos].enqueue(taskp, pos);
 }
 
 
 inline bool
-Task::Future_selector::Future_wait::is_ready(const Channel_waits& chans) const
+Task::Future_selector::Future_wait::is_ready(const State_waits& waits) const
 {
-    if (!*signalp && (chans[vpos].is_ready() || chans[epos].is_ready()))
-        *signalp = true;
-
-    return *signalp;
+    return waits[pos].is_ready();
 }
 
 
 inline bool
 Task::Future_selector::Future_wait::operator==(const Future_wait& other) const
 {
-    return this->signalp == other.signalp;
+    return this->statep == other.statep;
 }
 
 
 inline bool
 Task::Future_selector::Future_wait::operator< (const Future_wait& other) const
 {
-    if (this->signalp < other.signalp) return true;
-    if (other.signalp < this->signalp) return false;
-    if (this->vpos < other.vpos) return true;
-    if (other.vpos < this->vpos) return false;
-    if (this->epos < other.epos) return true;
+    if (this->statep < other.statep) return true;
+    if (other.statep < this->statep) return false;
+    if (this->pos < other.pos) return true;
     return false;
 }
 
 
 inline Channel_size
-Task::Future_selector::Future_wait::value() const
+Task::Future_selector::Future_wait::wait() const
 {
-    return vpos;
+    return pos;
 }
 
 
@@ -203,14 +262,14 @@ Task::Future_selector::Wait_setup::Wait_setup(const Future<T>* first, const Futu
     : waitsp(wsp)
 {
     waitsp->assign(first, last);
-    waitsp->lock_channels();
+    waitsp->lock_states();
 }
 
 
 inline
 Task::Future_selector::Wait_setup::~Wait_setup()
 {
-    waitsp->unlock_channels();
+    waitsp->unlock_states();
 }
 
 
@@ -221,7 +280,7 @@ template<class T>
 void
 Task::Future_selector::Wait_set::assign(const Future<T>* first, const Future<T>* last)
 {
-    transform(first, last, &futures, &channels);
+    transform(first, last, &futures, &states);
     index_unique(futures, &index);
     nenqueued = 0;
 }
@@ -250,25 +309,23 @@ Task::Future_selector::Wait_set::size() const
 
 template<class T>
 void
-Task::Future_selector::Wait_set::transform(const Future<T>* first, const Future<T>* last, Future_waits* fwaitsp, Channel_waits* cwaitsp)
+Task::Future_selector::Wait_set::transform(const Future<T>* first, const Future<T>* last, Future_waits* fwaitsp, State_waits* swaitsp)
 {
     const auto nfs = last - first;
 
     fwaitsp->clear();
     fwaitsp->reserve(nfs);
 
-    cwaitsp->clear();
-    cwaitsp->reserve(nfs * 2);
+    swaitsp->clear();
+    swaitsp->reserve(nfs);
 
     for (const Future<T>* fp = first; fp != last; ++fp) {
         if (fp->is_valid()) {
             const Channel_size fpos = fwaitsp->size();
-            const Channel_size vpos = cwaitsp->size();
-            const Channel_size epos = vpos + 1;
+            const Channel_size spos = swaitsp->size();
 
-            cwaitsp->push_back({fp->value_channel(), fpos});
-            cwaitsp->push_back({fp->error_channel(), fpos});
-            fwaitsp->push_back({fp->ready_flag(), vpos, epos});
+            swaitsp->push_back({fp->state(), fpos});
+            fwaitsp->push_back({fp->state(), spos});
         }
     }
 }
@@ -280,7 +337,8 @@ Task::Future_selector::Wait_set::transform(const Future<T>* first, const Future<
 inline void
 Task::Future_selector::Timer::start(Task::Promise* taskp, Duration duration) const
 {
-    scheduler.start_timer(taskp, duration);
+    schedp = taskp->owner();
+    alarm = schedp->start_timer(taskp, duration);
     state = running;
 }
 
@@ -355,13 +413,10 @@ Task::Future_selector::selection() const
 /*
     Task Promise
 */
-inline void
-Task::Promise::erase_local(Local_key key)
-{
-    locals.erase(key);
-}
-
-
+/*
+    A finished task returns to its worker's run loop, which switches to a
+    task it woke (held in the worker's next slot) ahead of other work.
+*/
 inline Task::Final_suspend
 Task::Promise::final_suspend()
 {
@@ -371,7 +426,7 @@ Task::Promise::final_suspend()
 
 
 inline void*
-Task::Promise::find_local(Local_key key)
+Task::Promise::find_local(Local_key key) const
 {
     return locals.find(key);
 }
@@ -403,44 +458,73 @@ inline Task::Select_status
 Task::Promise::notify_operation_complete(Channel_size pos)
 {
     const Lock lock{mutex};
-    return operations.notify_complete(this, pos);
+    return operations.notify_complete(pos);
 }
 
 
 inline bool
-Task::Promise::notify_timer_canceled()
+Task::Promise::notify_timer_expired(Time when)
 {
     const Lock lock{mutex};
-    return futures.notify_timer_canceled();
+    return futures.notify_timer_expired(this, when);
 }
 
 
-inline bool
-Task::Promise::notify_timer_expired(Time when)
+inline void
+Task::Promise::operator delete(void* p, std::size_t n)
 {
-    const Lock lock{mutex};
-    return futures.notify_timer_expired(this, when);
+    Scheduler::deallocate_frame(p, n);
+}
+
+
+inline void*
+Task::Promise::operator new(std::size_t n)
+{
+    return Scheduler::allocate_frame(n);
+}
+
+
+inline Scheduler*
+Task::Promise::owner() const
+{
+    return schedp;
 }
 
 
 template<Channel_size N>
-inline void
+inline bool
 Task::Promise::select(const Channel_operation (&ops)[N])
 {
     using std::begin;
     using std::end;
 
-    select(begin(ops), end(ops));
+    return select(begin(ops), end(ops));
 }
 
 
-inline void
+inline bool
 Task::Promise::select(const Channel_operation* first, const Channel_operation* last)
 {
     Lock lock{mutex};
 
-    if (!operations.select(this, first, last))
+    const bool is_selected = operations.select(this, first, last);
+    if (!is_selected)
+        suspend(&lock);
+
+    return is_selected;
+}
+
+
+inline bool
+Task::Promise::select(const Select_set& set)
+{
+    Lock lock{mutex};
+
+    const bool is_selected = operations.select(this, set);
+    if (!is_selected)
         suspend(&lock);
+
+    return is_selected;
 }
 
 
@@ -484,10 +568,24 @@ Task::Promise::try_select(const Channel_operation* first, const Channel_operatio
 }
 
 
+inline optional<Channel_size>
+Task::Promise::try_select(const Select_set& set)
+{
+    return Operation_selector::try_select(set);
+}
+
+
+inline void*
+Task::Promise::release_local(Local_key key)
+{
+    return locals.release(key);
+}
+
+
 inline void
-Task::Promise::update_local(Local_key key, Local_impl&& obj)
+Task::Promise::reset_local(Local_key key, void* objectp, const Local_deleter_ptr& deleterp)
 {
-    locals.update(key, std::move(obj));
+    locals.reset(key, objectp, deleterp);
 }
 
 
@@ -551,7 +649,8 @@ Task_local<T>::User_deleter<D>::operator()(void* p) const
 template<typename T>
 inline
 Task_local<T>::Task_local()
-    : deleter{make_deleter()}
+    : key{Task::make_local_key()}
+    , deleterp{default_deleter()}
 {
 }
 
@@ -560,33 +659,34 @@ template<typename T>
 template<typename D>
 inline
 Task_local<T>::Task_local(D dimpl)
-    : deleter{make_deleter(std::move(dimpl))}
+    : key{Task::make_local_key()}
+    , deleterp{std::make_shared<const User_deleter<D>>(std::move(dimpl))}
 {
 }
 
 
 template<typename T>
-inline T*
-Task_local<T>::get(Task::Promise* taskp)
+inline
+Task_local<T>::~Task_local()
 {
-    return static_cast<T*>(taskp->find_local(this));
+    Task::free_local_key(key);
 }
 
 
 template<typename T>
-inline Task::Local_deleter
-Task_local<T>::make_deleter()
+inline const Task::Local_deleter_ptr&
+Task_local<T>::default_deleter()
 {
-    return Default_deleter();
+    static const Task::Local_deleter_ptr deleterp{std::make_shared<const Default_deleter>()};
+    return deleterp;
 }
 
 
 template<typename T>
-template<typename D>
-inline Task::Local_deleter
-Task_local<T>::make_deleter(D&& impl)
+inline T*
+Task_local<T>::get(Task::Promise* taskp)
 {
-    return User_deleter<D>(std::forward<D>(impl));
+    return static_cast<T*>(taskp->find_local(key));
 }
 
 
@@ -594,7 +694,7 @@ template<typename T>
 inline T*
 Task_local<T>::release(Task::Promise* taskp)
 {
-    return static_cast<T*>(taskp->release_local(this));
+    return static_cast<T*>(taskp->release_local(key));
 }
 
 
@@ -602,28 +702,18 @@ template<typename T>
 inline void
 Task_local<T>::reset(Task::Promise* taskp, T* p)
 {
-    if (p)
-        taskp->update_local(this, Local_object{p, deleter});
-    else
-        taskp->erase_local(this);
+    taskp->reset_local(key, p, deleterp);
 }
 
 
 /*
     Task Local Implementation
 */
-inline
-Task::Local_impl::Local_impl(void* objectp, Local_deleter d)
-    : p{objectp}
-    , destroy{d}
-{
-}
-
-
 inline
 Task::Local_impl::Local_impl(Local_impl&& other)
     : p{other.p}
-    , destroy{std::move(other.destroy)}
+    , deleterp{std::move(other.deleterp)}
+    , owner{other.owner}
 {
     other.p = nullptr;
 }
@@ -632,14 +722,14 @@ Task::Local_impl::Local_impl(Local_impl&& other)
 inline
 Task::Local_impl::~Local_impl()
 {
-    if (p) destroy(p);
+    if (p) (*deleterp)(p);
 }
 
 
 inline void*
-Task::Local_impl::get() const
+Task::Local_impl::get(std::size_t generation) const
 {
-    return p;
+    return owner == generation ? p : nullptr;
 }
 
 
@@ -647,27 +737,37 @@ inline Task::Local_impl&
 Task::Local_impl::operator=(Local_impl&& other)
 {
     Local_impl temp{std::move(other)};
-    
-    swap(*this, other);
+
+    swap(*this, temp);
     return *this;
 }
 
 
 inline void*
-Task::Local_impl::release()
+Task::Local_impl::release(std::size_t generation)
 {
-    void* objectp = p;
+    void* objectp = nullptr;
+
+    if (owner == generation) {
+        objectp = p;
+        p = nullptr;
+    }
 
-    p = nullptr;
     return objectp;
 }
 
 
+/*
+    An object left by a destroyed Task_local is destroyed when its slot is
+    reset by the Task_local that reuses the index.
+*/
 inline void
-Task::Local_impl::reset(void* objectp)
+Task::Local_impl::reset(std::size_t generation, void* objectp, const Local_deleter_ptr& dp)
 {
-    if (p) destroy(p);
+    if (p) (*deleterp)(p);
     p = objectp;
+    deleterp = dp;
+    owner = generation;
 }
 
 
@@ -677,7 +777,23 @@ swap(Task::Local_impl& x, Task::Local_impl& y)
     using std::swap;
 
     swap(x.p, y.p);
-    swap(x.destroy, y.destroy);
+    swap(x.deleterp, y.deleterp);
+    swap(x.owner, y.owner);
+}
+
+
+/*
+    Task Local Slots
+*/
+inline void*
+Task::Local_slots::find(Local_key key) const
+{
+    const std::size_t i = key.index;
+
+    if (i < ninline)
+        return inlines[i].get(key.generation);
+
+    return i - ninline < overflow.size() ? overflow[i - ninline].get(key.generation) : nullptr;
 }
 
 
@@ -729,6 +845,16 @@ Task::operator bool() const
 }
 
 
+inline Task::Handle
+Task::release()
+{
+    const Handle h = coro;
+
+    coro = nullptr;
+    return h;
+}
+
+
 inline Task::State
 Task::resume()
 {
@@ -763,6 +889,85 @@ swap(Task& x, Task& y)
 }
 
 
+/*
+    Channel Waiter
+*/
+inline
+Channel_waiter::Channel_waiter(Thread_parker* parkerp, const void* lvaluep)
+    : threadp{parkerp}
+    , lvbufp{lvaluep}
+{
+    assert(parkerp != nullptr);
+    assert(lvaluep != nullptr);
+}
+
+
+inline
+Channel_waiter::Channel_waiter(Thread_parker* parkerp, void* rvaluep)
+    : threadp{parkerp}
+    , rvbufp{rvaluep}
+{
+    assert(parkerp != nullptr);
+    assert(rvaluep != nullptr);
+}
+
+
+inline void
+Channel_waiter::assign(Task::Promise* tskp, Channel_size oper, const void* lvaluep, void* rvaluep)
+{
+    assert(!isqueued);
+    assert(tskp != nullptr);
+
+    taskp       = tskp;
+    taskoper    = oper;
+    threadp     = nullptr;
+    lvbufp      = lvaluep;
+    rvbufp      = rvaluep;
+}
+
+
+inline bool
+Channel_waiter::is_queued() const
+{
+    return isqueued;
+}
+
+
+inline const void*
+Channel_waiter::lvalue() const
+{
+    return lvbufp;
+}
+
+
+inline Channel_size
+Channel_waiter::operation() const
+{
+    return taskoper;
+}
+
+
+inline Thread_parker*
+Channel_waiter::parker() const
+{
+    return threadp;
+}
+
+
+inline void*
+Channel_waiter::rvalue() const
+{
+    return rvbufp;
+}
+
+
+inline Task::Promise*
+Channel_waiter::task() const
+{
+    return taskp;
+}
+
+
 /*
     Channel Operation
 */
@@ -884,7 +1089,7 @@ inline void
 Channel<T>::Readable_waiter::notify(Mutex* mutexp) const
 {
     if (notify_channel_readable(taskp, chanpos, mutexp))
-        scheduler.resume(taskp);
+        taskp->owner()->resume(taskp);
 }
 
 
@@ -917,12 +1122,44 @@ Channel<T>::Readable_waiter::task() const
 template<class T>
 inline
 Channel<T>::Buffer::Buffer(Channel_size maxsize)
-    : sizemax{maxsize >= 0 ? maxsize : 0}
+    : storage{allocate(maxsize, &elems)}
+    , sizemax{maxsize >= 0 ? maxsize : 0}
 {
     assert(maxsize >= 0);
 }
 
 
+template<class T>
+Channel<T>::Buffer::~Buffer()
+{
+    while (count > 0) {
+        element(head)->~T();
+        head = (head + 1 == sizemax) ? 0 : head + 1;
+        --count;
+    }
+}
+
+
+template<class T>
+typename Channel<T>::Buffer::Storage
+Channel<T>::Buffer::allocate(Channel_size n, T** elemspp)
+{
+    static_assert(alignof(T) <= cache_line_size, "channel element alignment exceeds a cache line");
+
+    Storage storage;
+
+    if (n > 0) {
+        const std::size_t nbytes    = static_cast<std::size_t>(n) * sizeof(T) + cache_line_size - 1;
+        storage.reset(new char[nbytes]);
+        const std::uintptr_t addr   = reinterpret_cast<std::uintptr_t>(storage.get());
+        const std::uintptr_t offset = (cache_line_size - addr % cache_line_size) % cache_line_size;
+        *elemspp = reinterpret_cast<T*>(storage.get() + offset);
+    }
+
+    return storage;
+}
+
+
 template<class T>
 inline Channel_size
 Channel<T>::Buffer::capacity() const
@@ -931,6 +1168,14 @@ Channel<T>::Buffer::capacity() const
 }
 
 
+template<class T>
+inline T*
+Channel<T>::Buffer::element(Channel_size i) const
+{
+    return elems + (i < sizemax ? i : i - sizemax);
+}
+
+
 template<class T>
 inline void
 Channel<T>::Buffer::enqueue(const Readable_waiter& r)
@@ -959,7 +1204,7 @@ template<class T>
 inline bool
 Channel<T>::Buffer::is_empty() const
 {
-    return elemq.empty();
+    return count == 0;
 }
 
 
@@ -981,8 +1226,11 @@ Channel<T>::Buffer::pop(U* valuep)
     const bool is_data = !is_empty();
 
     if (is_data) {
-        *valuep = move(elemq.front());
-        elemq.pop();
+        T* elemp = element(head);
+        *valuep = move(*elemp);
+        elemp->~T();
+        head = (head + 1 == sizemax) ? 0 : head + 1;
+        --count;
     }
 
     return is_data;
@@ -1017,8 +1265,10 @@ Channel<T>::Buffer::push_silent(U&& value)
 
     const bool is_capacity = !is_full();
 
-    if (is_capacity)
-        elemq.push(move(value));
+    if (is_capacity) {
+        new (element(head + count)) T(move(value));
+        ++count;
+    }
 
     return is_capacity;
 }
@@ -1028,214 +1278,363 @@ template<class T>
 inline Channel_size
 Channel<T>::Buffer::size() const
 {
-    return static_cast<Channel_size>(elemq.size());
+    return count;
 }
 
 
 /*
-    Channel I/O Queue
+    Channel Ring
 */
 template<class T>
-template<class U>
-inline typename Channel<T>::Io_queue<U>::Iterator
-Channel<T>::Io_queue<U>::end()
+Channel<T>::Ring::Ring(Channel_size maxsize, bool is_shared)
+    : cells{maxsize > 0 ? new Cell[maxsize] : nullptr}
+    , sizemax{maxsize > 0 ? static_cast<Index>(maxsize) : 0}
+    , is_multiproducer{is_shared}
 {
-    return waiters.end();
+    assert(maxsize >= 0);
+
+    for (Index i = 0; i < sizemax; ++i)
+        cells[i].seq.store(free_seq(i), std::memory_order_relaxed);
 }
 
 
 template<class T>
-template<class U>
-inline void
-Channel<T>::Io_queue<U>::erase(Iterator p)
+inline Channel_size
+Channel<T>::Ring::capacity() const
 {
-    waiters.erase(p);
+    return static_cast<Channel_size>(sizemax);
 }
 
 
 template<class T>
-template<class U>
-inline typename Channel<T>::Io_queue<U>::Iterator
-Channel<T>::Io_queue<U>::find(Task::Promise* taskp, Channel_size pos)
+inline void
+Channel<T>::Ring::enqueue(const Readable_waiter& r)
 {
-    using std::find_if;
-
-    return find_if(waiters.begin(), waiters.end(), waiter_eq(taskp, pos));
+    readers.push_back(r);
 }
 
 
 template<class T>
-template<class U>
-inline bool
-Channel<T>::Io_queue<U>::is_found(const Waiter& w) const
+bool
+Channel<T>::Ring::dequeue(const Readable_waiter& r)
 {
     using std::find;
 
-    const auto p = find(waiters.begin(), waiters.end(), w);
-    return p != waiters.end();
-}
+    const auto rp       = find(readers.begin(), readers.end(), r);
+    const bool is_found = rp != readers.end();
 
+    if (is_found)
+        readers.erase(rp);
 
-template<class T>
-template<class U>
-inline bool
-Channel<T>::Io_queue<U>::is_empty() const
-{
-    return waiters.empty();
+    return is_found;
 }
 
 
 template<class T>
-template<class U>
-inline U
-Channel<T>::Io_queue<U>::pop()
+inline T*
+Channel<T>::Ring::front()
 {
-    const U w = waiters.front();
+    const Index pos     = head.load(std::memory_order_relaxed);
+    Cell&       cell    = cells[pos % sizemax];
 
-    waiters.pop_front();
-    return w;
+    return cell.seq.load(std::memory_order_acquire) == full_seq(pos) ? &cell.value : nullptr;
 }
 
 
+/*
+    A cell's sequence number is even while the cell is free for the
+    producer at a position and odd once that producer has published its
+    element, so that a full ring is distinct from an empty one even with a
+    single cell.
+*/
 template<class T>
-template<class U>
-inline void
-Channel<T>::Io_queue<U>::push(const Waiter& w)
+inline typename Channel<T>::Ring::Index
+Channel<T>::Ring::free_seq(Index pos)
 {
-    waiters.push_back(w);
+    return 2 * pos;
 }
 
 
-/*
-    Channel Receive Operation
-*/
 template<class T>
-inline
-Channel<T>::Receive::Receive(Task::Promise* tskp, Channel_size oper, T* valuep)
-    : taskp{tskp}
-    , taskoper{oper}
-    , threadcondp{nullptr}
-    , bufp{valuep}
+inline typename Channel<T>::Ring::Index
+Channel<T>::Ring::full_seq(Index pos)
 {
-    assert(tskp != nullptr);
-    assert(valuep != nullptr);
+    return 2 * pos + 1;
 }
 
 
 template<class T>
-inline
-Channel<T>::Receive::Receive(Condition* condp, T* valuep)
-    : taskp{nullptr}
-    , taskoper{-1}
-    , threadcondp{condp}
-    , bufp{valuep}
+inline bool
+Channel<T>::Ring::is_empty() const
 {
-    assert(condp != nullptr);
-    assert(valuep != nullptr);
+    if (sizemax == 0)
+        return true;
+
+    const Index pos = head.load(std::memory_order_relaxed);
+    return cells[pos % sizemax].seq.load(std::memory_order_acquire) != full_seq(pos);
+}
+
+
+template<class T>
+inline bool
+Channel<T>::Ring::is_full() const
+{
+    return size() == capacity();
+}
+
+
+template<class T>
+inline bool
+Channel<T>::Ring::is_waited() const
+{
+    return !readers.empty();
+}
+
+
+template<class T>
+inline void
+Channel<T>::Ring::notify(Mutex* mutexp)
+{
+    if (!readers.empty()) {
+        const Readable_waiter waiter = readers.front();
+        readers.pop_front();
+        waiter.notify(mutexp);
+    }
 }
 
 
 template<class T>
 template<class U>
 bool
-Channel<T>::Receive::dequeue(U* sendbufp, Mutex* mutexp) const
+Channel<T>::Ring::pop(U* valuep)
 {
     using std::move;
 
-    bool is_dequeued = false;
+    T* elemp = front();
 
-    if (taskp) {
-        const Task::Select_status selection = notify_complete(taskp, taskoper, mutexp);
+    if (elemp) {
+        *valuep = move(*elemp);
+        pop_front();
+    }
 
-        if (selection.operation() == taskoper) {
-            *bufp = move(*sendbufp);
-            is_dequeued = true;
-        }
+    return elemp != nullptr;
+}
 
-        if (selection.is_complete())
-            scheduler.resume(taskp);
-    } else {
-        *bufp = move(*sendbufp);
-        threadcondp->notify_one();
-        is_dequeued = true;
-    }
 
-    return is_dequeued;
+template<class T>
+inline void
+Channel<T>::Ring::pop_front()
+{
+    const Index pos = head.load(std::memory_order_relaxed);
+
+    // Recycle the cell for the producer one lap ahead.
+    cells[pos % sizemax].seq.store(free_seq(pos + sizemax), std::memory_order_release);
+    head.store(pos + 1, std::memory_order_release);
 }
 
 
 template<class T>
-inline Channel_size
-Channel<T>::Receive::operation() const
+template<class U>
+bool
+Channel<T>::Ring::push(U&& value, Mutex* mutexp)
 {
-    return taskoper;
+    const bool is_pushed = push_silent(std::forward<U>(value));
+
+    if (is_pushed)
+        notify(mutexp);
+
+    return is_pushed;
 }
 
 
 template<class T>
-inline Task::Promise*
-Channel<T>::Receive::task() const
+template<class U>
+bool
+Channel<T>::Ring::push_silent(U&& value)
 {
-    return taskp;
+    if (sizemax == 0)
+        return false;
+
+    Index pos = tail.load(std::memory_order_relaxed);
+    Cell* cellp;
+
+    for (;;) {
+        cellp = &cells[pos % sizemax];
+
+        const Index             seq = cellp->seq.load(std::memory_order_acquire);
+        const std::ptrdiff_t    dif = static_cast<std::ptrdiff_t>(seq - free_seq(pos));
+
+        if (dif < 0)
+            return false;   // full
+
+        if (dif == 0) {
+            if (!is_multiproducer) {
+                tail.store(pos + 1, std::memory_order_relaxed);
+                break;
+            }
+
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else
+            pos = tail.load(std::memory_order_relaxed);
+    }
+
+    cellp->value = std::forward<U>(value);
+    cellp->seq.store(full_seq(pos), std::memory_order_release);
+    return true;
+}
+
+
+template<class T>
+inline Channel_size
+Channel<T>::Ring::size() const
+{
+    // Load the head first so that it can't pass the tail.
+    const Index first   = head.load(std::memory_order_acquire);
+    const Index last    = tail.load(std::memory_order_acquire);
+
+    return static_cast<Channel_size>(last - first);
 }
 
 
 /*
-    Channel Send Operation
+    Channel I/O Queue
 */
 template<class T>
-inline
-Channel<T>::Send::Send(Task::Promise* tskp, Channel_size oper, const T* lvaluep)
-    : taskp{tskp}
-    , taskoper{oper}
-    , threadcondp{nullptr}
-    , lvbufp{lvaluep}
-    , rvbufp{nullptr}
+template<class U>
+bool
+Channel<T>::Io_queue<U>::erase(Channel_waiter* waiterp)
 {
-    assert(tskp != nullptr);
-    assert(lvaluep != nullptr);
+    const bool is_queued = waiterp->isqueued;
+
+    if (is_queued) {
+        Channel_waiter* prevp = waiterp->prevp;
+        Channel_waiter* nextp = waiterp->nextp;
+
+        if (prevp)
+            prevp->nextp = nextp;
+        else
+            headp = nextp;
+
+        if (nextp)
+            nextp->prevp = prevp;
+        else
+            tailp = prevp;
+
+        waiterp->prevp      = nullptr;
+        waiterp->nextp      = nullptr;
+        waiterp->isqueued   = false;
+    }
+
+    return is_queued;
 }
 
 
 template<class T>
-inline
-Channel<T>::Send::Send(Task::Promise* tskp, Channel_size oper, T* rvaluep)
-    : taskp{tskp}
-    , taskoper{oper}
-    , threadcondp{nullptr}
-    , lvbufp{nullptr}
-    , rvbufp{rvaluep}
+template<class U>
+inline bool
+Channel<T>::Io_queue<U>::is_empty() const
 {
-    assert(tskp != nullptr);
-    assert(rvaluep != nullptr);
+    return headp == nullptr;
 }
 
 
+template<class T>
+template<class U>
+inline U
+Channel<T>::Io_queue<U>::pop()
+{
+    Channel_waiter* waiterp = headp;
+
+    headp = waiterp->nextp;
+    if (headp)
+        headp->prevp = nullptr;
+    else
+        tailp = nullptr;
+
+    waiterp->nextp      = nullptr;
+    waiterp->isqueued   = false;
+    return U{*waiterp};
+}
+
+
+template<class T>
+template<class U>
+inline void
+Channel<T>::Io_queue<U>::push(Channel_waiter* waiterp)
+{
+    assert(!waiterp->isqueued);
+
+    waiterp->prevp      = tailp;
+    waiterp->nextp      = nullptr;
+    waiterp->isqueued   = true;
+
+    if (tailp)
+        tailp->nextp = waiterp;
+    else
+        headp = waiterp;
+
+    tailp = waiterp;
+}
+
+
+/*
+    Channel Receive Operation
+*/
 template<class T>
 inline
-Channel<T>::Send::Send(Condition* condp, const T* lvaluep)
-    : taskp{nullptr}
-    , taskoper{-1}
-    , threadcondp{condp}
-    , lvbufp{lvaluep}
-    , rvbufp{nullptr}
+Channel<T>::Receive::Receive(const Channel_waiter& waiter)
+    : taskp{waiter.task()}
+    , taskoper{waiter.operation()}
+    , threadp{waiter.parker()}
+    , bufp{static_cast<T*>(waiter.rvalue())}
 {
-    assert(condp != nullptr);
-    assert(lvaluep != nullptr);
+    assert(bufp != nullptr);
 }
 
 
+template<class T>
+template<class U>
+bool
+Channel<T>::Receive::dequeue(U* sendbufp, Mutex* mutexp) const
+{
+    using std::move;
+
+    bool is_dequeued = false;
+
+    if (taskp) {
+        const Task::Select_status selection = notify_complete(taskp, taskoper, mutexp);
+
+        if (selection.operation() == taskoper) {
+            *bufp = move(*sendbufp);
+            is_dequeued = true;
+        }
+
+        if (selection.is_complete())
+            taskp->owner()->resume(taskp);
+    } else {
+        *bufp = move(*sendbufp);
+        threadp->unpark();
+        is_dequeued = true;
+    }
+
+    return is_dequeued;
+}
+
+
+/*
+    Channel Send Operation
+*/
 template<class T>
 inline
-Channel<T>::Send::Send(Condition* condp, T* rvaluep)
-    : taskp{nullptr}
-    , taskoper{-1}
-    , threadcondp{condp}
-    , lvbufp{nullptr}
-    , rvbufp{rvaluep}
+Channel<T>::Send::Send(const Channel_waiter& waiter)
+    : taskp{waiter.task()}
+    , taskoper{waiter.operation()}
+    , threadp{waiter.parker()}
+    , lvbufp{static_cast<const T*>(waiter.lvalue())}
+    , rvbufp{static_cast<T*>(waiter.rvalue())}
 {
-    assert(condp != nullptr);
-    assert(rvaluep != nullptr);
+    assert(lvbufp != nullptr || rvbufp != nullptr);
 }
 
 
@@ -1255,10 +1654,10 @@ Channel<T>::Send::dequeue(U* recvbufp, Mutex* mutexp) const
         }
 
         if (selection.is_complete())
-            scheduler.resume(taskp);
+            taskp->owner()->resume(taskp);
     } else {
         move(lvbufp, rvbufp, recvbufp);
-        threadcondp->notify_one();
+        threadp->unpark();
         is_dequeued = true;
     }
 
@@ -1290,22 +1689,6 @@ Channel<T>::Send::move(const T* lvsendbufp, T* rvsendbufp, Buffer* recvbufp)
 }
 
 
-template<class T>
-inline Channel_size
-Channel<T>::Send::operation() const
-{
-    return taskoper;
-}
-
-
-template<class T>
-inline Task::Promise*
-Channel<T>::Send::task() const
-{
-    return taskp;
-}
-
-
 /*
     Channel Receive Awaitable
 */
@@ -1321,7 +1704,7 @@ template<class T>
 inline bool
 Channel<T>::Receive_awaitable::await_ready()
 {
-    return false;
+    return receive[0].try_execute();
 }
 
 
@@ -1333,12 +1716,16 @@ Channel<T>::Receive_awaitable::await_resume()
 }
 
 
+/*
+    If the receive completes while the operation is being selected (e.g., a
+    sender arrived after await_ready()), the task carries on without
+    suspending instead of going back through the scheduler's queues.
+*/
 template<class T>
 inline bool
 Channel<T>::Receive_awaitable::await_suspend(Task::Handle task)
 {
-    task.promise().select(receive);
-    return true;
+    return !task.promise().select(receive);
 }
 
 
@@ -1358,7 +1745,7 @@ template<class T>
 inline bool
 Channel<T>::Send_awaitable::await_ready()
 {
-    return false;
+    return send[0].try_execute();
 }
 
 
@@ -1373,8 +1760,103 @@ template<class T>
 inline bool
 Channel<T>::Send_awaitable::await_suspend(Task::Handle task)
 {
-    task.promise().select(send);
-    return true;
+    return !task.promise().select(send);
+}
+
+
+/*
+    Channel Batched Receive Awaitable
+*/
+template<class T>
+inline
+Channel<T>::Receive_n_awaitable::Receive_n_awaitable(Impl* channelp, T* first, Channel_size n)
+    : chanp{channelp}
+    , elemsp{first}
+    , nelems{n}
+    , receive{chanp->make_receive(first)}
+{
+}
+
+
+template<class T>
+inline bool
+Channel<T>::Receive_n_awaitable::await_ready()
+{
+    if (nelems > 0)
+        nreceived = chanp->try_receive_n(elemsp, nelems);
+
+    return nreceived > 0 || nelems == 0;
+}
+
+
+/*
+    If the task was suspended, the first element arrived while it waited,
+    so take whatever else is already available.
+*/
+template<class T>
+inline Channel_size
+Channel<T>::Receive_n_awaitable::await_resume()
+{
+    if (nreceived == 0 && nelems > 0)
+        nreceived = 1 + chanp->try_receive_n(elemsp + 1, nelems - 1);
+
+    return nreceived;
+}
+
+
+template<class T>
+inline bool
+Channel<T>::Receive_n_awaitable::await_suspend(Task::Handle task)
+{
+    return !task.promise().select(receive);
+}
+
+
+/*
+    Channel Batched Send Awaitable
+*/
+template<class T>
+inline
+Channel<T>::Send_n_awaitable::Send_n_awaitable(Impl* channelp, const T* first, Channel_size n)
+    : chanp{channelp}
+    , elemsp{first}
+    , nelems{n}
+    , send{chanp->make_send(first)}
+{
+}
+
+
+template<class T>
+inline bool
+Channel<T>::Send_n_awaitable::await_ready()
+{
+    if (nelems > 0)
+        nsent = chanp->try_send_n(elemsp, nelems);
+
+    return nsent > 0 || nelems == 0;
+}
+
+
+/*
+    If the task was suspended, the first element was taken while it
+    waited, so send whatever else the channel will accept.
+*/
+template<class T>
+inline Channel_size
+Channel<T>::Send_n_awaitable::await_resume()
+{
+    if (nsent == 0 && nelems > 0)
+        nsent = 1 + chanp->try_send_n(elemsp + 1, nelems - 1);
+
+    return nsent;
+}
+
+
+template<class T>
+inline bool
+Channel<T>::Send_n_awaitable::await_suspend(Task::Handle task)
+{
+    return !task.promise().select(send);
 }
 
 
@@ -1383,12 +1865,29 @@ Channel<T>::Send_awaitable::await_suspend(Task::Handle task)
 */
 template<class T>
 inline
-Channel<T>::Impl::Impl(Channel_size bufsize)
-    : buffer{bufsize}
+Channel<T>::Impl::Impl(Channel_size bufsize, Channel_flavor f)
+    : flavor{bufsize > 0 ? f : Channel_flavor::mpmc}
+    , buffer{flavor == Channel_flavor::mpmc ? bufsize : 0}
+    , ring{flavor == Channel_flavor::mpmc ? 0 : bufsize, flavor == Channel_flavor::mpsc}
 {
 }
 
 
+template<class T>
+inline void
+Channel<T>::Impl::announce(std::atomic<bool>* flagp)
+{
+    /*
+        A waiter announces itself before its final check of the ring (and
+        the fence pairs with the one in wake_readers() or try_pop()), so
+        that either the waiter sees the element or space, or the other
+        side sees the waiter.
+    */
+    flagp->store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+
 template<class T>
 inline typename Channel<T>::Receive_awaitable
 Channel<T>::Impl::awaitable_receive()
@@ -1397,6 +1896,14 @@ Channel<T>::Impl::awaitable_receive()
 }
 
 
+template<class T>
+inline typename Channel<T>::Receive_n_awaitable
+Channel<T>::Impl::awaitable_receive_n(T* first, Channel_size n)
+{
+    return Receive_n_awaitable(this, first, n);
+}
+
+
 template<class T>
 template<class U>
 inline typename Channel<T>::Send_awaitable
@@ -1407,28 +1914,80 @@ Channel<T>::Impl::awaitable_send(U* valuep)
 
 
 template<class T>
-T
-Channel<T>::Impl::blocking_receive()
+inline typename Channel<T>::Send_n_awaitable
+Channel<T>::Impl::awaitable_send_n(const T* first, Channel_size n)
 {
-    T       value;
-    Lock    lock{mutex};
+    return Send_n_awaitable(this, first, n);
+}
 
-    if (!receive(&value, &buffer, &sendq, &mutex))
-        wait_for_sender(&receiveq, &value, &lock);
 
+template<class T>
+inline T
+Channel<T>::Impl::blocking_receive()
+{
+    T value;
+
+    blocking_receive(&value);
     return value;
 }
 
 
+template<class T>
+void
+Channel<T>::Impl::blocking_receive(T* valuep)
+{
+    if (is_lockfree())
+        lockfree_blocking_receive(valuep);
+    else {
+        Lock lock{mutex};
+        if (!receive(valuep, &buffer, &sendq, &mutex))
+            wait_for_sender(&receiveq, valuep, &lock);
+    }
+}
+
+
+template<class T>
+Channel_size
+Channel<T>::Impl::blocking_receive_n(T* first, Channel_size n)
+{
+    Channel_size nreceived = try_receive_n(first, n);
+
+    if (nreceived == 0 && n > 0) {
+        blocking_receive(first);
+        nreceived = 1 + try_receive_n(first + 1, n - 1);
+    }
+
+    return nreceived;
+}
+
+
 template<class T>
 template<class U>
 inline void
 Channel<T>::Impl::blocking_send(U* valuep)
 {
-    Lock lock{mutex};
+    if (is_lockfree())
+        lockfree_blocking_send(valuep);
+    else {
+        Lock lock{mutex};
+        if (!send(valuep, &buffer, &receiveq, &mutex))
+            wait_for_receiver(&sendq, valuep, &lock);
+    }
+}
+
+
+template<class T>
+Channel_size
+Channel<T>::Impl::blocking_send_n(const T* first, Channel_size n)
+{
+    Channel_size nsent = try_send_n(first, n);
+
+    if (nsent == 0 && n > 0) {
+        blocking_send(first);
+        nsent = 1 + try_send_n(first + 1, n - 1);
+    }
 
-    if (!send(valuep, &buffer, &receiveq, &mutex))
-        wait_for_receiver(&sendq, valuep, &lock);
+    return nsent;
 }
 
 
@@ -1436,6 +1995,9 @@ template<class T>
 Channel_size
 Channel<T>::Impl::capacity() const
 {
+    if (is_lockfree())
+        return ring.capacity();
+
     const Lock lock{mutex};
     return buffer.capacity();
 }
@@ -1474,132 +2036,321 @@ Channel<T>::Impl::dequeue(Send_queue* qp, U* recvbufp, Mutex* mutexp)
 
 
 template<class T>
-template<class U>
-inline bool
-Channel<T>::Impl::dequeue(U* qp, Task::Promise* taskp, Channel_size oper)
+bool
+Channel<T>::Impl::dequeue_readable_wait(Task::Promise* taskp, Channel_size wait)
+{
+    return is_lockfree() ? ring.dequeue({taskp, wait}) : buffer.dequeue({taskp, wait});
+}
+
+
+template<class T>
+bool
+Channel<T>::Impl::dequeue_receive(Channel_waiter* waiterp)
+{
+    const bool is_dequeued = receiveq.erase(waiterp);
+
+    if (is_lockfree())
+        is_reader_waiting.store(!receiveq.is_empty() || ring.is_waited(), std::memory_order_relaxed);
+
+    return is_dequeued;
+}
+
+
+template<class T>
+bool
+Channel<T>::Impl::dequeue_send(Channel_waiter* waiterp)
+{
+    const bool is_dequeued = sendq.erase(waiterp);
+
+    if (is_lockfree())
+        is_writer_waiting.store(!sendq.is_empty(), std::memory_order_relaxed);
+
+    return is_dequeued;
+}
+
+
+/*
+    A waiter is announced to the lock-free side of the channel once it's
+    queued.  The ring is then checked again, since an element pushed
+    before the announcement was visible won't have been handed over.
+*/
+template<class T>
+bool
+Channel<T>::Impl::enqueue_receive(Channel_waiter* waiterp)
+{
+    receiveq.push(waiterp);
+    if (!is_lockfree())
+        return false;
+
+    announce(&is_reader_waiting);
+    return !ring.is_empty();
+}
+
+
+template<class T>
+void
+Channel<T>::Impl::enqueue_readable_wait(Task::Promise* taskp, Channel_size wait)
+{
+    if (is_lockfree())
+        ring.enqueue({taskp, wait});
+    else
+        buffer.enqueue({taskp, wait});
+}
+
+
+template<class T>
+bool
+Channel<T>::Impl::enqueue_send(Channel_waiter* waiterp)
+{
+    sendq.push(waiterp);
+    if (!is_lockfree())
+        return false;
+
+    announce(&is_writer_waiting);
+    return !ring.is_full();
+}
+
+
+template<class T>
+inline bool
+Channel<T>::Impl::enter_fast()
+{
+    /*
+        Producers sharing a ring must not fill it while another holds the
+        channel lock for a selection, because that could invalidate the
+        selection's test for writability.  So the lock raises a gate and
+        waits for fast producers to leave.
+    */
+    if (flavor != Channel_flavor::mpsc)
+        return true;
+
+    nfast.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ngates.load(std::memory_order_relaxed) > 0) {
+        nfast.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    return true;
+}
+
+
+template<class T>
+bool
+Channel<T>::Impl::fast_receive(void* valuep)
+{
+    return is_lockfree() && try_pop(static_cast<T*>(valuep)) == Io_status::complete;
+}
+
+
+template<class T>
+bool
+Channel<T>::Impl::fast_send(const void* lvaluep)
+{
+    return is_lockfree() && try_push(static_cast<const T*>(lvaluep)) == Io_status::complete;
+}
+
+
+template<class T>
+bool
+Channel<T>::Impl::fast_send(void* rvaluep)
+{
+    return is_lockfree() && try_push(static_cast<T*>(rvaluep)) == Io_status::complete;
+}
+
+
+template<class T>
+bool
+Channel<T>::Impl::is_empty() const
 {
-    const auto opp      = qp->find(taskp, oper);
-    const bool is_found = opp != qp->end();
+    if (is_lockfree())
+        return ring.is_empty();
 
-    if (is_found)
-        qp->erase(opp);
-    
-    return is_found;
+    const Lock lock{mutex};
+    return buffer.is_empty();
 }
 
 
 template<class T>
 bool
-Channel<T>::Impl::dequeue_readable_wait(Task::Promise* taskp, Channel_size wait)
+Channel<T>::Impl::is_full() const
 {
-    return buffer.dequeue({taskp, wait});
+    if (is_lockfree())
+        return ring.is_full();
+
+    const Lock lock{mutex};
+    return buffer.is_full();
 }
 
 
 template<class T>
-bool
-Channel<T>::Impl::dequeue_receive(Task::Promise* taskp, Channel_size oper)
+inline bool
+Channel<T>::Impl::is_lockfree() const
 {
-    return dequeue(&receiveq, taskp, oper);
+    return flavor != Channel_flavor::mpmc;
 }
 
 
 template<class T>
 bool
-Channel<T>::Impl::dequeue_send(Task::Promise* taskp, Channel_size oper)
+Channel<T>::Impl::is_readable() const
 {
-    return dequeue(&sendq, taskp, oper);
+    if (!is_lockfree())
+        return !(buffer.is_empty() && sendq.is_empty());
+
+    return !(ring.is_empty() && sendq.is_empty());
 }
 
 
 template<class T>
-void
-Channel<T>::Impl::enqueue_receive(Task::Promise* taskp, Channel_size oper, void* valuep)
+bool
+Channel<T>::Impl::is_writable() const
 {
-    enqueue_receive(taskp, oper, static_cast<T*>(valuep));
+    if (!is_lockfree())
+        return !(buffer.is_full() && receiveq.is_empty());
+
+    return !(ring.is_full() && receiveq.is_empty());
 }
 
 
 template<class T>
 inline void
-Channel<T>::Impl::enqueue_receive(Task::Promise* taskp, Channel_size oper, T* valuep)
+Channel<T>::Impl::leave_fast()
 {
-    receiveq.push({taskp, oper, valuep});
+    if (flavor == Channel_flavor::mpsc)
+        nfast.fetch_sub(1, std::memory_order_release);
 }
 
 
 template<class T>
 void
-Channel<T>::Impl::enqueue_readable_wait(Task::Promise* taskp, Channel_size wait)
+Channel<T>::Impl::lock()
 {
-    buffer.enqueue({taskp, wait});
+    mutex.lock();
+
+    if (flavor == Channel_flavor::mpsc) {
+        ngates.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (nfast.load(std::memory_order_acquire) > 0)
+            std::this_thread::yield();
+    }
 }
 
 
 template<class T>
 void
-Channel<T>::Impl::enqueue_send(Task::Promise* taskp, Channel_size oper, const void* lvaluep)
+Channel<T>::Impl::lockfree_blocking_receive(T* valuep)
 {
-    enqueue_send(taskp, oper, static_cast<const T*>(lvaluep));
-}
+    if (try_pop(valuep) != Io_status::complete) {
+        Lock lock{mutex};
 
+        if (!receive(valuep, &ring, &sendq, &mutex)) {
+            announce(&is_reader_waiting);
+            if (!ring.pop(valuep))
+                wait_for_sender(&receiveq, valuep, &lock);
+        }
 
-template<class T>
-void
-Channel<T>::Impl::enqueue_send(Task::Promise* taskp, Channel_size oper, void* rvaluep)
-{
-    enqueue_send(taskp, oper, static_cast<T*>(rvaluep));
+        is_writer_waiting.store(!sendq.is_empty(), std::memory_order_relaxed);
+    }
 }
 
 
 template<class T>
 template<class U>
-inline void
-Channel<T>::Impl::enqueue_send(Task::Promise* taskp, Channel_size oper, U* valuep)
+void
+Channel<T>::Impl::lockfree_blocking_send(U* valuep)
 {
-    sendq.push({taskp, oper, valuep});
-}
+    using std::move;
 
+    if (try_push(valuep) != Io_status::complete) {
+        Lock lock{mutex};
 
-template<class T>
-bool
-Channel<T>::Impl::is_empty() const
-{
-    const Lock lock{mutex};
-    return buffer.is_empty();
+        if (!send(valuep, &ring, &receiveq, &mutex)) {
+            announce(&is_writer_waiting);
+            if (!ring.push(move(*valuep), &mutex))
+                wait_for_receiver(&sendq, valuep, &lock);
+        }
+
+        release_readers();
+    }
 }
 
 
 template<class T>
+template<class U>
 bool
-Channel<T>::Impl::is_full() const
+Channel<T>::Impl::lockfree_receive(U* valuep)
 {
+    switch (try_pop(valuep)) {
+    case Io_status::complete:   return true;
+    case Io_status::blocked:    return false;
+    default:                    break;
+    }
+
     const Lock lock{mutex};
-    return buffer.is_full();
+    const bool is_received = receive(valuep, &ring, &sendq, &mutex);
+
+    is_writer_waiting.store(!sendq.is_empty(), std::memory_order_relaxed);
+    return is_received;
 }
 
 
 template<class T>
-bool
-Channel<T>::Impl::is_readable() const
+Channel_size
+Channel<T>::Impl::lockfree_receive_n(T* first, Channel_size n)
 {
-    return !(buffer.is_empty() && sendq.is_empty());
+    Channel_size    nreceived   = 0;
+    Io_status       status      = Io_status::complete;
+
+    while (nreceived < n && (status = try_pop(first + nreceived)) == Io_status::complete)
+        ++nreceived;
+
+    if (status == Io_status::contended) {
+        const Lock lock{mutex};
+        nreceived += receive_n(first + nreceived, n - nreceived, &ring, &sendq, &mutex);
+        is_writer_waiting.store(!sendq.is_empty(), std::memory_order_relaxed);
+    }
+
+    return nreceived;
 }
 
 
 template<class T>
+template<class U>
 bool
-Channel<T>::Impl::is_writable() const
+Channel<T>::Impl::lockfree_send(U* valuep)
 {
-    return !(buffer.is_full() && receiveq.is_empty());
+    switch (try_push(valuep)) {
+    case Io_status::complete:   return true;
+    case Io_status::blocked:    return false;
+    default:                    break;
+    }
+
+    const Lock lock{mutex};
+    const bool is_sent = send(valuep, &ring, &receiveq, &mutex);
+
+    release_readers();
+    return is_sent;
 }
 
 
 template<class T>
-void
-Channel<T>::Impl::lock()
+Channel_size
+Channel<T>::Impl::lockfree_send_n(const T* first, Channel_size n)
 {
-    mutex.lock();
+    Channel_size    nsent   = 0;
+    Io_status       status  = Io_status::complete;
+
+    while (nsent < n && (status = try_push(first + nsent)) == Io_status::complete)
+        ++nsent;
+
+    if (status == Io_status::contended) {
+        const Lock lock{mutex};
+        nsent += send_n(first + nsent, n - nsent, &ring, &receiveq, &mutex);
+        release_readers();
+    }
+
+    return nsent;
 }
 
 
@@ -1627,28 +2378,96 @@ Channel<T>::Impl::make_send(const T* valuep)
 }
 
 
+template<class T>
+inline void
+Channel<T>::Impl::operator delete(void* p, std::size_t n)
+{
+    Scheduler::deallocate_frame(p, n);
+}
+
+
+template<class T>
+inline void*
+Channel<T>::Impl::operator new(std::size_t n)
+{
+    return Scheduler::allocate_frame(n);
+}
+
+
 template<class T>
 void
 Channel<T>::Impl::receive(void* valuep)
 {
-    receive(static_cast<T*>(valuep), &buffer, &sendq, &mutex);
+    if (is_lockfree()) {
+        receive(static_cast<T*>(valuep), &ring, &sendq, &mutex);
+        is_writer_waiting.store(!sendq.is_empty(), std::memory_order_relaxed);
+    } else
+        receive(static_cast<T*>(valuep), &buffer, &sendq, &mutex);
 }
 
 
 template<class T>
-template<class U>
+template<class U, class B>
 inline bool
-Channel<T>::Impl::receive(U* valuep, Buffer* bufp, Send_queue* qp, Mutex* mutexp)
+Channel<T>::Impl::receive(U* valuep, B* bufp, Send_queue* qp, Mutex* mutexp)
 {
     return bufp->pop(valuep) || dequeue(qp, valuep, mutexp);
 }
 
 
+/*
+    Receive up to n elements while the channel is locked.  Each waiting
+    sender is dequeued (and so awakened) at most once.
+*/
+template<class T>
+template<class U, class B>
+Channel_size
+Channel<T>::Impl::receive_n(U* first, Channel_size n, B* bufp, Send_queue* qp, Mutex* mutexp)
+{
+    Channel_size nreceived = 0;
+
+    while (nreceived < n && receive(first + nreceived, bufp, qp, mutexp))
+        ++nreceived;
+
+    return nreceived;
+}
+
+
+/*
+    Hand elements in the ring to waiting readers (the consumer is parked,
+    so it's safe to pop on its behalf), then refresh the announcement.
+    The channel must be locked.
+*/
+template<class T>
+void
+Channel<T>::Impl::release_readers()
+{
+    while (!receiveq.is_empty()) {
+        T* elemp = ring.front();
+
+        if (!elemp)
+            break;
+
+        if (dequeue(&receiveq, elemp, &mutex))
+            ring.pop_front();
+    }
+
+    if (!ring.is_empty())
+        ring.notify(&mutex);
+
+    is_reader_waiting.store(!receiveq.is_empty() || ring.is_waited(), std::memory_order_relaxed);
+}
+
+
 template<class T>
 void
 Channel<T>::Impl::send(const void* lvaluep)
 {
-    send(static_cast<const T*>(lvaluep), &buffer, &receiveq, &mutex);
+    if (is_lockfree()) {
+        send(static_cast<const T*>(lvaluep), &ring, &receiveq, &mutex);
+        release_readers();
+    } else
+        send(static_cast<const T*>(lvaluep), &buffer, &receiveq, &mutex);
 }
 
 
@@ -1656,37 +2475,103 @@ template<class T>
 void
 Channel<T>::Impl::send(void* rvaluep)
 {
-    send(static_cast<T*>(rvaluep), &buffer, &receiveq, &mutex);
+    if (is_lockfree()) {
+        send(static_cast<T*>(rvaluep), &ring, &receiveq, &mutex);
+        release_readers();
+    } else
+        send(static_cast<T*>(rvaluep), &buffer, &receiveq, &mutex);
 }
 
 
 template<class T>
-template<class U>
+template<class U, class B>
 inline bool
-Channel<T>::Impl::send(U* valuep, Buffer* bufp, Receive_queue* qp, Mutex* mutexp)
+Channel<T>::Impl::send(U* valuep, B* bufp, Receive_queue* qp, Mutex* mutexp)
 {
     using std::move;
     return dequeue(qp, valuep, mutexp) || bufp->push(move(*valuep), mutexp);
 }
 
 
+/*
+    Send up to n elements while the channel is locked.  Each waiting
+    receiver is handed one element (and so awakened) at most once.
+*/
+template<class T>
+template<class U, class B>
+Channel_size
+Channel<T>::Impl::send_n(U* first, Channel_size n, B* bufp, Receive_queue* qp, Mutex* mutexp)
+{
+    Channel_size nsent = 0;
+
+    while (nsent < n && send(first + nsent, bufp, qp, mutexp))
+        ++nsent;
+
+    return nsent;
+}
+
+
 template<class T>
 Channel_size
 Channel<T>::Impl::size() const
 {
+    if (is_lockfree())
+        return ring.size();
+
     Lock lock{mutex};
     return buffer.size();
 }
 
 
+template<class T>
+template<class U>
+typename Channel<T>::Impl::Io_status
+Channel<T>::Impl::try_pop(U* valuep)
+{
+    if (ring.pop(valuep))
+        return Io_status::complete;
+
+    // Senders wait only when the ring is full, so look for them once it's empty.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return is_writer_waiting.load(std::memory_order_relaxed) ? Io_status::contended : Io_status::blocked;
+}
+
+
+template<class T>
+template<class U>
+typename Channel<T>::Impl::Io_status
+Channel<T>::Impl::try_push(U* valuep)
+{
+    using std::move;
+
+    // If a reader is waiting, the element must be handed over under the lock.
+    if (is_reader_waiting.load(std::memory_order_relaxed) || !enter_fast())
+        return Io_status::contended;
+
+    const bool is_pushed = ring.push_silent(move(*valuep));
+
+    leave_fast();
+    if (!is_pushed)
+        return Io_status::blocked;
+
+    wake_readers();
+    return Io_status::complete;
+}
+
+
 template<class T>
 optional<T>
 Channel<T>::Impl::try_receive()
 {
     optional<T> value;
-    Lock        lock{mutex};
 
-    receive(&value, &buffer, &sendq, &mutex);
+    if (is_lockfree())
+        lockfree_receive(&value);
+    else {
+        const Lock lock{mutex};
+        receive(&value, &buffer, &sendq, &mutex);
+    }
+
     return value;
 }
 
@@ -1695,15 +2580,45 @@ template<class T>
 bool
 Channel<T>::Impl::try_send(const T& value)
 {
-    Lock lock{mutex};
+    if (is_lockfree())
+        return lockfree_send(&value);
+
+    const Lock lock{mutex};
     return send(&value, &buffer, &receiveq, &mutex);
 }
 
 
+template<class T>
+Channel_size
+Channel<T>::Impl::try_receive_n(T* first, Channel_size n)
+{
+    if (is_lockfree())
+        return lockfree_receive_n(first, n);
+
+    const Lock lock{mutex};
+    return receive_n(first, n, &buffer, &sendq, &mutex);
+}
+
+
+template<class T>
+Channel_size
+Channel<T>::Impl::try_send_n(const T* first, Channel_size n)
+{
+    if (is_lockfree())
+        return lockfree_send_n(first, n);
+
+    const Lock lock{mutex};
+    return send_n(first, n, &buffer, &receiveq, &mutex);
+}
+
+
 template<class T>
 void
 Channel<T>::Impl::unlock()
 {
+    if (flavor == Channel_flavor::mpsc)
+        ngates.fetch_sub(1, std::memory_order_release);
+
     mutex.unlock();
 }
 
@@ -1713,12 +2628,20 @@ template<class U>
 void
 Channel<T>::Impl::wait_for_receiver(Send_queue* qp, U* sendbufp, Lock* lockp)
 {
-    Condition   ready;
-    const Send  send{&ready, sendbufp};
+    Thread_parker   ready;
+    Channel_waiter  send{&ready, sendbufp};
 
-    // Enqueue the send and wait for a receiver to dequeue it.
-    qp->push(send);
-    ready.wait(*lockp, [&]{ return !qp->is_found(send); });
+    /*
+        Enqueue the send and wait for a receiver to dequeue it.  The
+        receiver unparks this thread while holding the channel lock, so the
+        parker outlives its use once the lock is reacquired.
+    */
+    qp->push(&send);
+    {
+        const Unlock_sentry unlock{lockp->mutex()};
+        ready.park();
+    }
+    assert(!send.is_queued());
 }
 
 
@@ -1726,12 +2649,29 @@ template<class T>
 void
 Channel<T>::Impl::wait_for_sender(Receive_queue* qp, T* recvbufp, Lock* lockp)
 {
-    Condition       ready;
-    const Receive   receive{&ready, recvbufp};
+    Thread_parker   ready;
+    Channel_waiter  receive{&ready, recvbufp};
 
     // Enqueue the receive and wait for a sender to dequeue it.
-    qp->push(receive);
-    ready.wait(*lockp, [&]{ return !qp->is_found(receive); });
+    qp->push(&receive);
+    {
+        const Unlock_sentry unlock{lockp->mutex()};
+        ready.park();
+    }
+    assert(!receive.is_queued());
+}
+
+
+template<class T>
+inline void
+Channel<T>::Impl::wake_readers()
+{
+    // The fence pairs with the one in announce().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (is_reader_waiting.load(std::memory_order_relaxed)) {
+        const Lock lock{mutex};
+        release_readers();
+    }
 }
 
 
@@ -1834,6 +2774,14 @@ Channel<T>::receive() const
 }
 
 
+template<class T>
+inline typename Channel<T>::Receive_n_awaitable
+Channel<T>::receive_n(T* first, Channel_size n) const
+{
+    return pimpl->awaitable_receive_n(first, n);
+}
+
+
 template<class T>
 inline typename Channel<T>::Send_awaitable
 Channel<T>::send(const T& value) const
@@ -1850,6 +2798,14 @@ Channel<T>::send(T&& value) const
 }
 
 
+template<class T>
+inline typename Channel<T>::Send_n_awaitable
+Channel<T>::send_n(const T* first, Channel_size n) const
+{
+    return pimpl->awaitable_send_n(first, n);
+}
+
+
 template<class T>
 inline Channel_size
 Channel<T>::size() const
@@ -1866,6 +2822,14 @@ Channel<T>::try_receive() const
 }
 
 
+template<class T>
+inline Channel_size
+Channel<T>::try_receive_n(T* first, Channel_size n) const
+{
+    return pimpl->try_receive_n(first, n);
+}
+
+
 template<class T>
 inline bool
 Channel<T>::try_send(const T& value) const
@@ -1874,11 +2838,20 @@ Channel<T>::try_send(const T& value) const
 }
 
 
+template<class T>
+inline Channel_size
+Channel<T>::try_send_n(const T* first, Channel_size n) const
+{
+    return pimpl->try_send_n(first, n);
+}
+
+
 template<class T>
 Channel<T>
-make_channel(Channel_size capacity)
+make_channel(Channel_size capacity, Channel_flavor flavor)
 {
-    return std::make_shared<Channel<T>::Impl>(capacity);
+    using Impl_ptr = typename Channel<T>::Impl_ptr;
+    return Impl_ptr{new typename Channel<T>::Impl(capacity, flavor)};
 }
 
 
@@ -1959,6 +2932,14 @@ Receive_channel<T>::receive() const
 }
 
 
+template<class T>
+inline typename Channel<T>::Receive_n_awaitable
+Receive_channel<T>::receive_n(T* first, Channel_size n) const
+{
+    return pimpl->awaitable_receive_n(first, n);
+}
+
+
 template<class T>
 inline Channel_size
 Receive_channel<T>::size() const
@@ -1975,6 +2956,14 @@ Receive_channel<T>::try_receive() const
 }
 
 
+template<class T>
+inline Channel_size
+Receive_channel<T>::try_receive_n(T* first, Channel_size n) const
+{
+    return pimpl->try_receive_n(first, n);
+}
+
+
 /*
     Send Channel
 */
@@ -2068,6 +3057,14 @@ Send_channel<T>::send(T&& value) const
 }
 
 
+template<class T>
+inline typename Channel<T>::Send_n_awaitable
+Send_channel<T>::send_n(const T* first, Channel_size n) const
+{
+    return pimpl->awaitable_send_n(first, n);
+}
+
+
 template<class T>
 inline Channel_size
 Send_channel<T>::size() const
@@ -2084,6 +3081,50 @@ Send_channel<T>::try_send(const T& value) const
 }
 
 
+template<class T>
+inline Channel_size
+Send_channel<T>::try_send_n(const T* first, Channel_size n) const
+{
+    return pimpl->try_send_n(first, n);
+}
+
+
+/*
+    Channel Operation Select Set
+*/
+template<Channel_size N>
+inline
+Select_set::Select_set(const Channel_operation (&ops)[N])
+{
+    assign(ops);
+}
+
+
+template<Channel_size N>
+inline void
+Select_set::assign(const Channel_operation (&ops)[N])
+{
+    using std::begin;
+    using std::end;
+
+    assign(begin(ops), end(ops));
+}
+
+
+inline Channel_select_awaitable
+Select_set::operator co_await() const
+{
+    return Channel_select_awaitable(this);
+}
+
+
+inline Channel_size
+Select_set::size() const
+{
+    return ops.size();
+}
+
+
 /*
     Channel Select Awaitable
 */
@@ -2095,6 +3136,13 @@ Channel_select_awaitable::Channel_select_awaitable(const Channel_operation* begi
 }
 
 
+inline
+Channel_select_awaitable::Channel_select_awaitable(const Select_set* sp)
+    : setp{sp}
+{
+}
+
+
 inline bool
 Channel_select_awaitable::await_ready()
 {
@@ -2109,12 +3157,17 @@ Channel_select_awaitable::await_resume()
 }
 
 
+/*
+    The task suspends only if none of the operations could be completed.
+*/
 inline bool
 Channel_select_awaitable::await_suspend(Task::Handle task)
 {
     promisep = &task.promise();
-    promisep->select(first, last);
-    return true;
+
+    const bool is_selected = setp ? promisep->select(*setp) : promisep->select(first, last);
+
+    return !is_selected;
 }
 
 
@@ -2139,6 +3192,13 @@ select(const Channel_operation (&ops)[N])
 }
 
 
+inline Channel_select_awaitable
+select(const Select_set& set)
+{
+    return Channel_select_awaitable(&set);
+}
+
+
 /*
     Non-Blocking Channel Operation Selection
 */
@@ -2161,6 +3221,13 @@ try_select(const Channel_operation (&ops)[N])
 }
 
 
+inline optional<Channel_size>
+try_select(const Select_set& set)
+{
+    return Task::Promise::try_select(set);
+}
+
+
 /*
     Channel of "void" Awaitable
 */
@@ -2174,7 +3241,7 @@ Channel<void>::Awaitable::Awaitable(const Channel_operation& op)
 inline bool
 Channel<void>::Awaitable::await_ready()
 {
-    return false;
+    return operation[0].try_execute();
 }
 
 
@@ -2187,8 +3254,7 @@ Channel<void>::Awaitable::await_resume()
 inline bool
 Channel<void>::Awaitable::await_suspend(Task::Handle task)
 {
-    task.promise().select(operation);
-    return true;
+    return !task.promise().select(operation);
 }
 
 
@@ -2196,8 +3262,8 @@ Channel<void>::Awaitable::await_suspend(Task::Handle task)
     Channel of "void" Implementation
 */
 inline
-Channel<void>::Impl::Impl(Channel_size bufsize)
-    : Channel<char>::Impl(bufsize)
+Channel<void>::Impl::Impl(Channel_size bufsize, Channel_flavor flavor)
+    : Channel<char>::Impl(bufsize, flavor)
 {
 }
 
@@ -2596,90 +3662,206 @@ swap(Send_channel<void>& x, Send_channel<void>& y)
 
 
 /*
-    Future Awaitable
+    Future State
 */
+inline bool
+Future_state_base::is_ready() const
+{
+    return isready.load(std::memory_order_acquire);
+}
+
+
+inline void
+Future_state_base::lock()
+{
+    mutex.lock();
+}
+
+
+inline void
+Future_state_base::operator delete(void* p, std::size_t n)
+{
+    Scheduler::deallocate_frame(p, n);
+}
+
+
+inline void*
+Future_state_base::operator new(std::size_t n)
+{
+    return Scheduler::allocate_frame(n);
+}
+
+
+inline bool
+Future_state_base::run_deferred()
+{
+    return false;
+}
+
+
+inline void
+Future_state_base::unlock()
+{
+    mutex.unlock();
+}
+
+
 template<class T>
-inline
-Future<T>::Awaitable::Awaitable(Future* fp)
-    : selfp{fp}
+inline T
+Future_state<T>::get()
 {
+    if (error)
+        rethrow_exception(error);
+
+    return std::move(*value);
 }
 
 
 template<class T>
-inline bool
-Future<T>::Awaitable::await_ready()
+inline void
+Future_state<T>::set_exception(exception_ptr ep)
 {
-    return selfp->is_ready();
+    error = ep;
+    publish();
 }
 
 
 template<class T>
-T
-Future<T>::Awaitable::await_resume()
+template<class Fun, class... Args>
+inline void
+Future_state<T>::set_result(Fun& f, Args&&... args)
 {
-    /*
-        If a future is ready, the result can be obtained from one of its
-        channels without waiting.  Otherwise, the task waiting on this
-        future has just awakened from a call to select() having received
-        either a value or an error.
-    */
-    if (selfp->is_ready())
-        v = selfp->get_ready();
-    else if (ep)
-        rethrow_exception(ep);
+    try {
+        value = f(std::forward<Args>(args)...);
+    } catch (...) {
+        error = std::current_exception();
+    }
 
-    return std::move(v);
+    publish();
 }
 
 
 template<class T>
+template<class U>
+inline void
+Future_state<T>::set_value(U&& x)
+{
+    value = std::forward<U>(x);
+    publish();
+}
+
+
+template<class Fun, class... Args>
+inline void
+Future_state<void>::set_result(Fun& f, Args&&... args)
+{
+    try {
+        f(std::forward<Args>(args)...);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    publish();
+}
+
+
+/*
+    Deferred Future State
+*/
+template<class T, class Fun, class... Args>
+template<class F, class... As>
+inline
+Deferred_future_state<T, Fun, Args...>::Deferred_future_state(F&& f, As&&... as)
+    : fun{std::forward<F>(f)}
+    , args{std::forward<As>(as)...}
+{
+}
+
+
+template<class T, class Fun, class... Args>
+template<std::size_t... Is>
+inline void
+Deferred_future_state<T, Fun, Args...>::run(std::index_sequence<Is...>)
+{
+    this->set_result(fun, std::get<Is>(std::move(args))...);
+}
+
+
+/*
+    The function is claimed before it runs so that it runs only once, even
+    if two tasks wait on the future concurrently.
+*/
+template<class T, class Fun, class... Args>
 bool
-Future<T>::Awaitable::await_suspend(Task::Handle task)
+Deferred_future_state<T, Fun, Args...>::run_deferred()
 {
-    ops[0] = selfp->vchan.make_receive(&v);
-    ops[1] = selfp->echan.make_receive(&ep);
-    task.promise().select(ops);
-    return true;
+    const bool is_claimed = !isclaimed.load(std::memory_order_relaxed)
+        && !isclaimed.exchange(true, std::memory_order_acquire);
+
+    if (is_claimed)
+        run(std::index_sequence_for<Args...>());
+
+    return is_claimed;
 }
 
 
 /*
-    Future     
+    Future Awaitable
 */
 template<class T>
 inline
-Future<T>::Future()
-    : isready{false}
+Future<T>::Awaitable::Awaitable(Future* fp)
+    : selfp{fp}
 {
 }
 
 
 template<class T>
-inline
-Future<T>::Future(Value_receiver vc, Error_receiver ec)
-    : vchan{std::move(vc)}
-    , echan{std::move(ec)}
-    , isready{vchan.size() > 0 || echan.size() > 0}
+inline bool
+Future<T>::Awaitable::await_ready()
+{
+    selfp->run_deferred();
+    return selfp->is_ready();
+}
+
+
+/*
+    Either the future was ready or the task waiting on it has just
+    awakened with its state published.
+*/
+template<class T>
+inline T
+Future<T>::Awaitable::await_resume()
+{
+    return selfp->get_ready();
+}
+
+
+template<class T>
+inline bool
+Future<T>::Awaitable::await_suspend(Task::Handle task)
 {
+    task.promise().wait_any(selfp, selfp + 1, optional<Duration>());
+    return true;
 }
 
 
+/*
+    Future     
+*/
 template<class T>
 inline
-Future<T>::Future(Future&& other)
-    : vchan{std::move(other.vchan)}
-    , echan{std::move(other.echan)}
-    , isready{other.isready}
+Future<T>::Future(State_ptr sp)
+    : statep{std::move(sp)}
 {
 }
 
 
 template<class T>
-inline Channel_base*
-Future<T>::error_channel() const
+inline
+Future<T>::Future(Future&& other)
+    : statep{std::move(other.statep)}
 {
-    return echan.pimpl.get();
 }
 
 
@@ -2691,22 +3873,16 @@ Future<T>::get()
 }
 
 
+/*
+    A result can only be taken once, so the future releases its state
+    (and becomes invalid).
+*/
 template<class T>
-T
+inline T
 Future<T>::get_ready()
 {
-    using std::move;
-
-    optional<T> vp = vchan.try_receive();
-
-    if (vp)
-        isready = false;
-    else if (optional<exception_ptr> epp = echan.try_receive()) {
-        isready = false;
-        rethrow_exception(*epp);
-    }
-
-    return move(*vp);
+    const State_ptr sp = std::move(statep);
+    return sp->get();
 }
 
 
@@ -2714,7 +3890,7 @@ template<class T>
 inline bool
 Future<T>::is_ready() const
 {
-    return isready;
+    return statep && statep->is_ready();
 }
 
 
@@ -2722,7 +3898,15 @@ template<class T>
 inline bool
 Future<T>::is_valid() const
 {
-    return vchan && echan ? true : false;
+    return statep ? true : false;
+}
+
+
+template<class T>
+inline bool
+Future<T>::run_deferred() const
+{
+    return statep && statep->run_deferred();
 }
 
 
@@ -2744,10 +3928,10 @@ Future<T>::operator co_await()
 
 
 template<class T>
-inline bool*
-Future<T>::ready_flag() const
+inline Future_state_base*
+Future<T>::state() const
 {
-    return &isready;
+    return statep.get();
 }
 
 
@@ -2755,24 +3939,12 @@ template<class T>
 optional<T>
 Future<T>::try_get()
 {
-    optional<T> vp = vchan.try_receive();
-
-    if (vp) {
-        isready = false;
-    } else if (optional<exception_ptr> epp = echan.try_receive()) {
-        isready = false;
-        rethrow_exception(*epp);
-    }
-
-    return vp;
-}
+    optional<T> v;
 
+    if (is_ready())
+        v = get_ready();
 
-template<class T>
-inline Channel_base*
-Future<T>::value_channel() const
-{
-    return vchan.pimpl.get();
+    return v;
 }
 
 
@@ -2789,42 +3961,40 @@ Future<void>::Awaitable::Awaitable(Future* fp)
 inline bool
 Future<void>::Awaitable::await_ready()
 {
+    selfp->run_deferred();
     return selfp->is_ready();
 }
 
 
-/*
-    Future "void"
-*/
-inline
-Future<void>::Future()
-    : isready{false}
+inline void
+Future<void>::Awaitable::await_resume()
 {
+    selfp->get_ready();
 }
 
 
-inline
-Future<void>::Future(Value_receiver vc, Error_receiver ec)
-    : vchan{std::move(vc)}
-    , echan{std::move(ec)}
-    , isready{vchan.size() > 0 || echan.size() > 0}
+inline bool
+Future<void>::Awaitable::await_suspend(Task::Handle task)
 {
+    task.promise().wait_any(selfp, selfp + 1, optional<Duration>());
+    return true;
 }
 
 
+/*
+    Future "void"
+*/
 inline
-Future<void>::Future(Future&& other)
-    : vchan{std::move(other.vchan)}
-    , echan{std::move(other.echan)}
-    , isready{other.isready}
+Future<void>::Future(State_ptr sp)
+    : statep{std::move(sp)}
 {
 }
 
 
-inline Channel_base*
-Future<void>::error_channel() const
+inline
+Future<void>::Future(Future&& other)
+    : statep{std::move(other.statep)}
 {
-    return echan.pimpl.get();
 }
 
 
@@ -2835,17 +4005,25 @@ Future<void>::get()
 }
 
 
+inline void
+Future<void>::get_ready()
+{
+    const State_ptr sp = std::move(statep);
+    sp->get();
+}
+
+
 inline bool
 Future<void>::is_ready() const
 {
-    return isready;
+    return statep && statep->is_ready();
 }
 
 
 inline bool
 Future<void>::is_valid() const
 {
-    return vchan && echan ? true : false;
+    return statep ? true : false;
 }
 
 
@@ -2864,17 +4042,17 @@ Future<void>::operator co_await()
 }
 
 
-inline bool*
-Future<void>::ready_flag() const
+inline bool
+Future<void>::run_deferred() const
 {
-    return &isready;
+    return statep && statep->run_deferred();
 }
 
 
-inline Channel_base*
-Future<void>::value_channel() const
+inline Future_state_base*
+Future<void>::state() const
 {
-    return vchan.pimpl.get();
+    return statep.get();
 }
 
 
@@ -2900,10 +4078,17 @@ All_futures_awaitable<T>::All_futures_awaitable(const Future<T>* begin, const Fu
 }
 
 
+/*
+    Deferred functions run on the awaiting task's worker before it waits,
+    so they're all complete by the time it suspends.
+*/
 template<class T>
 inline bool
 All_futures_awaitable<T>::await_ready()
 {
+    for (const Future<T>* fp = first; fp != last; ++fp)
+        fp->run_deferred();
+
     return false;
 }
 
@@ -2998,10 +4183,22 @@ Any_future_awaitable<T>::Any_future_awaitable(const Future<T>* begin, const Futu
 }
 
 
+/*
+    If none of the futures is ready, the first deferred function runs on
+    the awaiting task's worker, so that the task doesn't wait for a result
+    that nothing would produce.
+*/
 template<class T>
 inline bool
 Any_future_awaitable<T>::await_ready()
 {
+    if (std::none_of(first, last, [](const Future<T>& f) { return f.is_ready(); })) {
+        for (const Future<T>* fp = first; fp != last; ++fp) {
+            if (fp->run_deferred())
+                break;
+        }
+    }
+
     return false;
 }
 
@@ -3081,9 +4278,70 @@ template<class TaskFun, class... Args>
 inline void
 start(TaskFun task, Args&&... args)
 {
-    using std::forward;
+    Scheduler::this_scheduler().start(std::move(task), std::forward<Args>(args)...);
+}
+
+
+template<class TaskFun, class... Args>
+inline void
+start(Task_priority prio, TaskFun task, Args&&... args)
+{
+    Scheduler::this_scheduler().start(prio, std::move(task), std::forward<Args>(args)...);
+}
+
+
+template<class TaskFun, class... Args>
+inline void
+start(Node_hint hint, TaskFun task, Args&&... args)
+{
+    Scheduler::this_scheduler().start(hint, std::move(task), std::forward<Args>(args)...);
+}
+
+
+template<class TaskFun, class... Args>
+inline void
+start(Task_priority prio, Node_hint hint, TaskFun task, Args&&... args)
+{
+    Scheduler::this_scheduler().start(prio, hint, std::move(task), std::forward<Args>(args)...);
+}
+
+
+/*
+    Scheduler Task Launcher
+*/
+template<class TaskFun, class... Args>
+inline void
+Scheduler::start(TaskFun task, Args&&... args)
+{
+    // Qualified to keep argument-dependent lookup from finding boost::forward.
+    submit(task(std::forward<Args>(args)...));
+}
+
+
+template<class TaskFun, class... Args>
+inline void
+Scheduler::start(Task_priority prio, TaskFun task, Args&&... args)
+{
+    submit(task(std::forward<Args>(args)...), prio);
+}
+
+
+template<class TaskFun, class... Args>
+inline void
+Scheduler::start(Node_hint hint, TaskFun task, Args&&... args)
+{
+    start(Task_priority::normal, hint, std::move(task), std::forward<Args>(args)...);
+}
+
+
+template<class TaskFun, class... Args>
+void
+Scheduler::start(Task_priority prio, Node_hint hint, TaskFun task, Args&&... args)
+{
+    // The task's frame is allocated when the task function is invoked.
+    const Node_sentry sentry{this, hint};
 
-    scheduler.submit(task(forward<Args>(args)...));
+    submit(task(std::forward<Args>(args)...), prio);
 }
 
 
@@ -3091,34 +4349,46 @@ start(TaskFun task, Args&&... args)
     Asynchronous Function Invocation
 */
 template<class Fun, class... Args>
-Future<std::result_of_t<Fun(Args&&...)>>
+inline Future<std::result_of_t<Fun(Args&&...)>>
 async(Fun fun, Args&&... args)
 {
-    using std::current_exception;
-    using std::forward;
-    using std::move;
-    using Result            = std::result_of_t<Fun(Args&&...)>;
-    using Result_sender     = Send_channel<Result>;
-    using Error_sender      = Send_channel<exception_ptr>;
-
-    auto rchan  = make_channel<Result>(1);
-    auto echan  = make_channel<exception_ptr>(1);
-    auto task   = [](Result_sender r, Error_sender e, Fun f, Args&&... fargs) -> Task
-    {
-        exception_ptr ep;
+    return async(Launch_policy::eager, std::move(fun), std::forward<Args>(args)...);
+}
 
-        try {
-            co_await r.send(f(foward<Args>(fargs)...));
-        } catch (...) {
-            ep = current_exception();
-        }
 
-        if (ep)
-            co_await e.send(ep);
-    };
+template<class Fun, class... Args>
+Future<std::result_of_t<Fun(Args&&...)>>
+async(Launch_policy policy, Fun fun, Args&&... args)
+{
+    using Result    = std::result_of_t<Fun(Args&&...)>;
+    using State     = Future_state<Result>;
+    using State_ptr = typename Future<Result>::State_ptr;
+    using Deferred  = Deferred_future_state<Result, Fun, std::decay_t<Args>...>;
+
+    State_ptr statep;
+
+    switch (policy) {
+    case Launch_policy::deferred:
+        statep.reset(new Deferred(std::move(fun), std::forward<Args>(args)...));
+        break;
+
+    case Launch_policy::immediate:
+        statep.reset(new State);
+        statep->set_result(fun, std::forward<Args>(args)...);
+        break;
+
+    default:
+        statep.reset(new State);
+        start([](State_ptr sp, Fun f, std::decay_t<Args>... fargs) -> Task {
+            // The co_await only makes this a coroutine (the function runs
+            // when the task is scheduled, because tasks start suspended).
+            co_await std::experimental::suspend_never{};
+            sp->set_result(f, std::move(fargs)...);
+        }, statep, std::move(fun), std::forward<Args>(args)...);
+        break;
+    }
 
-    start(move(task), rchan, echan, move(fun), forward<Args>(args)...);
-    return Future<Result>{rchan, echan};
+    return Future<Result>{std::move(statep)};
 }
 
 
@@ -3127,8 +4397,11 @@ async(Fun fun, Args&&... args)
 */
 inline
 Timer::Timer(Timer&& other)
-    : chan{std::move(other.chan)}
+    : schedp{other.schedp}
+    , alarm{other.alarm}
+    , chan{std::move(other.chan)}
 {
+    other.alarm = Alarm_id();
 }
 
 
@@ -3163,7 +4436,10 @@ Timer::make_receive(Time* tp)
 inline Timer&
 Timer::operator=(Timer&& other)
 {
+    schedp = other.schedp;
+    alarm = other.alarm;
     chan = std::move(other.chan);
+    other.alarm = Alarm_id();
     return *this;
 }
 
@@ -3185,7 +4461,7 @@ Timer::receive()
 inline bool
 Timer::stop()
 {
-    return chan ? scheduler.stop_timer(chan) : false;
+    return alarm ? schedp->stop_timer(alarm) : false;
 }
 
 
@@ -3221,10 +4497,46 @@ inline void
 swap(Timer& x, Timer& y)
 {
     using std::swap;
+    swap(x.schedp, y.schedp);
+    swap(x.alarm, y.alarm);
     swap(x.chan, y.chan);
 }
 
 
+/*
+    Yield Awaitable
+*/
+inline bool
+Yield_awaitable::await_ready()
+{
+    return !Scheduler::is_slice_expired();
+}
+
+
+inline void
+Yield_awaitable::await_resume()
+{
+}
+
+
+inline bool
+Yield_awaitable::await_suspend(Task::Handle)
+{
+    // The task remains ready, so the scheduler requeues it.
+    return true;
+}
+
+
+/*
+    Time Slicing
+*/
+inline Yield_awaitable
+yield_if_needed()
+{
+    return Yield_awaitable();
+}
+
+
 }  // Coroutine
 }  // Isptech
 